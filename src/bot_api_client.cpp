@@ -0,0 +1,320 @@
+#include "include/metrics.h"
+#include "include/bot_api_client.h"
+
+namespace botApiClient
+{
+    using metrics::Metrics;
+
+    namespace
+    {
+        size_t appendBody(char *ptr, size_t size, size_t nmemb, void *userdata)
+        {
+            static_cast<std::string *>(userdata)->append(ptr, size * nmemb);
+            return size * nmemb;
+        }
+    }
+
+    /// @brief Create the client on the given io_context.
+    /// @param ioc[in] io_context running the server's I/O threads.
+    /// @param baseUrl[in] Bot API base, e.g. "https://api.telegram.org/bot<token>/".
+    /// @param timeout[in] Default per-request timeout.
+    BotApiClient::BotApiClient(boost::asio::io_context &ioc,
+                               std::string baseUrl,
+                               std::chrono::milliseconds timeout)
+        : _ioc(ioc),
+          _strand(boost::asio::make_strand(ioc)),
+          _timer(_strand),
+          _baseUrl(std::move(baseUrl)),
+          _timeout(timeout),
+          _multi(curl_multi_init()),
+          _inFlight(Metrics::instance().get("telegram_async_in_flight")),
+          _completed(Metrics::instance().get("telegram_async_completed_total")),
+          _failures(Metrics::instance().get("telegram_async_failures_total"))
+    {
+        if (!_multi)
+        {
+            throw std::runtime_error("Failed to initialize curl multi handle");
+        }
+
+        curl_multi_setopt(_multi, CURLMOPT_SOCKETFUNCTION, &BotApiClient::socketCallback);
+        curl_multi_setopt(_multi, CURLMOPT_SOCKETDATA, this);
+        curl_multi_setopt(_multi, CURLMOPT_TIMERFUNCTION, &BotApiClient::timerCallback);
+        curl_multi_setopt(_multi, CURLMOPT_TIMERDATA, this);
+
+        // Many requests share a single HTTP/2 connection to the Bot API
+        curl_multi_setopt(_multi, CURLMOPT_PIPELINING, CURLPIPE_MULTIPLEX);
+    }
+
+    /// NOTE: destroy the client only once the io_context has stopped.
+    /// Pending requests are dropped without calling their handlers.
+    BotApiClient::~BotApiClient()
+    {
+        for (auto &entry : _transfers)
+        {
+            curl_multi_remove_handle(_multi, entry.first);
+            curl_easy_cleanup(entry.first);
+        }
+        _transfers.clear();
+        _sockets.clear();
+
+        curl_multi_cleanup(_multi);
+    }
+
+    /// @brief Call a Bot API method without blocking.
+    /// @param method[in] Method name, e.g. "sendMessage".
+    /// @param form[in] Form-encoded parameters, GET when empty.
+    /// @param handler[in] Called with the response on the client's strand.
+    /// @param timeout[in] Request timeout, zero for the client default.
+    /// @return none.
+    void BotApiClient::call(const std::string &method, std::string form, Handler handler,
+                            std::chrono::milliseconds timeout)
+    {
+        auto transfer = std::make_shared<Transfer>();
+        transfer->url = _baseUrl + method;
+        transfer->form = std::move(form);
+        transfer->handler = std::move(handler);
+
+        transfer->timeoutMs = static_cast<long>((timeout.count() > 0 ? timeout : _timeout).count());
+
+        // The multi handle is only touched from the strand
+        boost::asio::post(_strand, [this, transfer]
+                          { start(transfer); });
+    }
+
+    /// @brief Call a Bot API method and get the response as a future.
+    /// @param method[in] Method name, e.g. "setWebhook".
+    /// @param form[in] Form-encoded parameters, GET when empty.
+    /// @return Future fulfilled once the request completes.
+    /// NOTE: never wait on the future from an I/O thread.
+    std::future<BotApiClient::Response> BotApiClient::call(const std::string &method, std::string form)
+    {
+        auto promise = std::make_shared<std::promise<Response>>();
+        call(method, std::move(form), [promise](Response response)
+             { promise->set_value(std::move(response)); });
+        return promise->get_future();
+    }
+
+    /// @brief Create the easy handle and add it to the multi handle.
+    /// @param transfer[in] The request.
+    /// @return none.
+    void BotApiClient::start(std::shared_ptr<Transfer> transfer)
+    {
+        CURL *easy = curl_easy_init();
+        if (!easy)
+        {
+            _failures.fetch_add(1, std::memory_order_relaxed);
+            transfer->response.code = CURLE_FAILED_INIT;
+            transfer->handler(std::move(transfer->response));
+            return;
+        }
+
+        transfer->easy = easy;
+        curl_easy_setopt(easy, CURLOPT_URL, transfer->url.c_str());
+        if (!transfer->form.empty())
+        {
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDS, transfer->form.data());
+            curl_easy_setopt(easy, CURLOPT_POSTFIELDSIZE, static_cast<long>(transfer->form.size()));
+        }
+        curl_easy_setopt(easy, CURLOPT_WRITEFUNCTION, &appendBody);
+        curl_easy_setopt(easy, CURLOPT_WRITEDATA, &transfer->response.body);
+        curl_easy_setopt(easy, CURLOPT_TIMEOUT_MS, transfer->timeoutMs);
+        curl_easy_setopt(easy, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(easy, CURLOPT_HTTP_VERSION, CURL_HTTP_VERSION_2TLS);
+        // Wait for the multiplexed connection instead of opening another one
+        curl_easy_setopt(easy, CURLOPT_PIPEWAIT, 1L);
+
+        _transfers.emplace(easy, transfer);
+        _inFlight.fetch_add(1, std::memory_order_relaxed);
+        curl_multi_add_handle(_multi, easy);
+    }
+
+    /// @brief Track the events curl wants on a socket.
+    /// @param fd[in] The socket.
+    /// @param what[in] CURL_POLL_IN, _OUT, _INOUT or _REMOVE.
+    /// @return none.
+    void BotApiClient::watch(curl_socket_t fd, int what)
+    {
+        auto it = _sockets.find(fd);
+
+        if (what == CURL_POLL_REMOVE)
+        {
+            if (it != _sockets.end())
+            {
+                // Cancels the pending waits, curl closes the socket itself
+                it->second->what = CURL_POLL_REMOVE;
+                it->second->descriptor.release();
+                _sockets.erase(it);
+            }
+            return;
+        }
+
+        if (it == _sockets.end())
+        {
+            it = _sockets.emplace(fd, std::make_shared<Socket>(_ioc, fd)).first;
+        }
+        it->second->what = what;
+        arm(it->second, fd);
+    }
+
+    /// @brief Wait for readiness in the directions curl asked for.
+    /// @param socket[in] The watched socket.
+    /// @param fd[in] Its descriptor.
+    /// @return none.
+    /// NOTE: the epoll reactor is edge triggered and async_wait does not
+    /// look at the socket first, so readiness that arrived before the
+    /// wait was armed is checked with poll() and handled right away.
+    void BotApiClient::arm(const std::shared_ptr<Socket> &socket, curl_socket_t fd)
+    {
+        using wait_type = boost::asio::posix::stream_descriptor::wait_type;
+
+        const auto waitFor = [this, &socket, fd](bool &pending, wait_type type, short events, int flag)
+        {
+            pending = true;
+            auto onReady = [this, socket, fd, &pending, flag](boost::system::error_code ec)
+            {
+                pending = false;
+                if (ec == boost::asio::error::operation_aborted || socket->what == CURL_POLL_REMOVE)
+                {
+                    return;
+                }
+                onSocketReady(fd, ec ? CURL_CSELECT_ERR : flag);
+            };
+
+            pollfd probe{fd, events, 0};
+            if (::poll(&probe, 1, 0) > 0)
+            {
+                boost::asio::post(_strand, [onReady]
+                                  { onReady(boost::system::error_code()); });
+                return;
+            }
+            socket->descriptor.async_wait(type, boost::asio::bind_executor(_strand, onReady));
+        };
+
+        if ((socket->what & CURL_POLL_IN) && !socket->reading)
+        {
+            waitFor(socket->reading, wait_type::wait_read, POLLIN, CURL_CSELECT_IN);
+        }
+
+        if ((socket->what & CURL_POLL_OUT) && !socket->writing)
+        {
+            waitFor(socket->writing, wait_type::wait_write, POLLOUT, CURL_CSELECT_OUT);
+        }
+    }
+
+    /// @brief Let curl progress a ready socket, then keep watching it.
+    /// @param fd[in] The socket.
+    /// @param flag[in] CURL_CSELECT_IN, _OUT or _ERR.
+    /// @return none.
+    void BotApiClient::onSocketReady(curl_socket_t fd, int flag)
+    {
+        action(fd, flag);
+
+        const auto it = _sockets.find(fd);
+        if (it != _sockets.end())
+        {
+            arm(it->second, fd);
+        }
+    }
+
+    /// @brief curl's timer expired.
+    /// @param none.
+    /// @return none.
+    void BotApiClient::onTimeout()
+    {
+        action(CURL_SOCKET_TIMEOUT, 0);
+    }
+
+    /// @brief Drive the multi handle and collect finished transfers.
+    /// @param fd[in] The ready socket or CURL_SOCKET_TIMEOUT.
+    /// @param flags[in] Readiness flags.
+    /// @return none.
+    void BotApiClient::action(curl_socket_t fd, int flags)
+    {
+        curl_multi_socket_action(_multi, fd, flags, &_running);
+        completeTransfers();
+
+        if (_running == 0)
+        {
+            _timer.cancel();
+        }
+    }
+
+    /// @brief Hand finished transfers to their handlers.
+    /// @param none.
+    /// @return none.
+    void BotApiClient::completeTransfers()
+    {
+        int pending = 0;
+        while (CURLMsg *message = curl_multi_info_read(_multi, &pending))
+        {
+            if (message->msg != CURLMSG_DONE)
+            {
+                continue;
+            }
+
+            CURL *easy = message->easy_handle;
+            const CURLcode result = message->data.result;
+
+            const auto it = _transfers.find(easy);
+            if (it == _transfers.end())
+            {
+                continue;
+            }
+            auto transfer = it->second;
+            _transfers.erase(it);
+
+            transfer->response.code = result;
+            curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &transfer->response.status);
+            curl_multi_remove_handle(_multi, easy);
+            curl_easy_cleanup(easy);
+            transfer->easy = nullptr;
+
+            _inFlight.fetch_sub(1, std::memory_order_relaxed);
+            _completed.fetch_add(1, std::memory_order_relaxed);
+            if (!transfer->response.ok())
+            {
+                _failures.fetch_add(1, std::memory_order_relaxed);
+            }
+
+            if (transfer->handler)
+            {
+                try
+                {
+                    transfer->handler(std::move(transfer->response));
+                }
+                catch (const std::exception &e)
+                {
+                    spdlog::error("Bot API handler failed: {}", e.what());
+                }
+            }
+        }
+    }
+
+    int BotApiClient::socketCallback(CURL *, curl_socket_t fd, int what, void *userp, void *)
+    {
+        static_cast<BotApiClient *>(userp)->watch(fd, what);
+        return 0;
+    }
+
+    /// NOTE: curl must not be re-entered from here, the timer always
+    /// fires from the io_context, even for a zero timeout.
+    int BotApiClient::timerCallback(CURLM *, long timeoutMs, void *userp)
+    {
+        auto *self = static_cast<BotApiClient *>(userp);
+        if (timeoutMs < 0)
+        {
+            self->_timer.cancel();
+            return 0;
+        }
+
+        self->_timer.expires_after(std::chrono::milliseconds(timeoutMs));
+        self->_timer.async_wait(boost::asio::bind_executor(self->_strand, [self](boost::system::error_code ec)
+                                                           {
+                                                               if (!ec)
+                                                               {
+                                                                   self->onTimeout();
+                                                               } }));
+        return 0;
+    }
+
+} // !namespace botApiClient
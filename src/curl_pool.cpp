@@ -0,0 +1,162 @@
+#include "include/metrics.h"
+#include "include/curl_pool.h"
+
+namespace curlPool
+{
+    using metrics::Metrics;
+
+    /// @brief Create an empty pool and its share handle.
+    /// @param name[in] Metric prefix, e.g. "telegram".
+    /// @param maxIdle[in] Number of idle handles kept warm.
+    /// @param shareWith[in] Pool whose share handle is used instead of a
+    /// new one, it must outlive this pool.
+    CurlPool::CurlPool(const std::string &name, std::size_t maxIdle, CurlPool *shareWith)
+        : _maxIdle(maxIdle),
+          _ownsShare(shareWith == nullptr),
+          _share(shareWith ? shareWith->_share : curl_share_init()),
+          _requests(Metrics::instance().get(name + "_http_requests_total")),
+          _newConnections(Metrics::instance().get(name + "_http_connections_new_total")),
+          _reusedConnections(Metrics::instance().get(name + "_http_connections_reused_total")),
+          _failures(Metrics::instance().get(name + "_http_failures_total"))
+    {
+        if (_share && _ownsShare)
+        {
+            curl_share_setopt(_share, CURLSHOPT_LOCKFUNC, &CurlPool::lockShare);
+            curl_share_setopt(_share, CURLSHOPT_UNLOCKFUNC, &CurlPool::unlockShare);
+            curl_share_setopt(_share, CURLSHOPT_USERDATA, this);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_DNS);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_SSL_SESSION);
+            curl_share_setopt(_share, CURLSHOPT_SHARE, CURL_LOCK_DATA_CONNECT);
+        }
+    }
+
+    /// NOTE: every lease must be returned before the pool is destroyed.
+    CurlPool::~CurlPool()
+    {
+        for (CURL *handle : _idle)
+        {
+            curl_easy_cleanup(handle);
+        }
+        _idle.clear();
+
+        if (_share && _ownsShare)
+        {
+            curl_share_cleanup(_share);
+        }
+    }
+
+    /// @brief Borrow a handle, reusing an idle one when available.
+    /// @param none.
+    /// @return The lease, empty if curl could not create a handle.
+    CurlPool::Lease CurlPool::acquire()
+    {
+        CURL *handle = nullptr;
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (!_idle.empty())
+            {
+                handle = _idle.back();
+                _idle.pop_back();
+            }
+        }
+
+        if (!handle)
+        {
+            handle = curl_easy_init();
+        }
+
+        if (handle)
+        {
+            prepare(handle);
+        }
+        return Lease(*this, handle);
+    }
+
+    /// @brief Run a transfer and record whether its connection was reused.
+    /// @param handle[in] A leased handle with its options set.
+    /// @return The curl result.
+    CURLcode CurlPool::perform(CURL *handle)
+    {
+        const CURLcode res = curl_easy_perform(handle);
+        _requests.fetch_add(1, std::memory_order_relaxed);
+
+        if (res != CURLE_OK)
+        {
+            _failures.fetch_add(1, std::memory_order_relaxed);
+            return res;
+        }
+
+        long connects = 0;
+        curl_easy_getinfo(handle, CURLINFO_NUM_CONNECTS, &connects);
+        if (connects == 0)
+        {
+            _reusedConnections.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            _newConnections.fetch_add(static_cast<std::uint64_t>(connects), std::memory_order_relaxed);
+        }
+        return res;
+    }
+
+    /// @brief Append the response body to a std::string.
+    /// @param userdata[in] The std::string to append to.
+    /// @return The number of bytes consumed.
+    size_t CurlPool::appendCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        static_cast<std::string *>(userdata)->append(ptr, size * nmemb);
+        return size * nmemb;
+    }
+
+    /// @brief Give a handle back, or drop it if enough are idle.
+    /// @param handle[in] The returned handle.
+    /// @return none.
+    void CurlPool::release(CURL *handle)
+    {
+        // Forget the previous request's options, connections stay cached
+        curl_easy_reset(handle);
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_idle.size() < _maxIdle)
+            {
+                _idle.push_back(handle);
+                return;
+            }
+        }
+        curl_easy_cleanup(handle);
+    }
+
+    /// @brief Apply the options every pooled request needs.
+    /// @param handle[in] The handle to prepare.
+    /// @return none.
+    void CurlPool::prepare(CURL *handle)
+    {
+        if (_share)
+        {
+            curl_easy_setopt(handle, CURLOPT_SHARE, _share);
+        }
+        // Handles are used from several threads
+        curl_easy_setopt(handle, CURLOPT_NOSIGNAL, 1L);
+        curl_easy_setopt(handle, CURLOPT_TCP_KEEPALIVE, 1L);
+    }
+
+    void CurlPool::lockShare(CURL *, curl_lock_data data, curl_lock_access, void *userptr)
+    {
+        static_cast<CurlPool *>(userptr)->_shareLocks[data].lock();
+    }
+
+    void CurlPool::unlockShare(CURL *, curl_lock_data data, void *userptr)
+    {
+        static_cast<CurlPool *>(userptr)->_shareLocks[data].unlock();
+    }
+
+    CurlPool::Lease::~Lease()
+    {
+        if (_handle)
+        {
+            _pool->release(_handle);
+        }
+    }
+
+} // !namespace curlPool
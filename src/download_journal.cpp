@@ -0,0 +1,198 @@
+#include "include/download_journal.h"
+
+#include <fcntl.h>
+
+namespace downloadJournal
+{
+    namespace
+    {
+        /// @brief Write all of a buffer, retrying short writes.
+        bool writeAll(int fd, std::string_view data)
+        {
+            while (!data.empty())
+            {
+                const ssize_t written = ::write(fd, data.data(), data.size());
+                if (written < 0)
+                {
+                    if (errno == EINTR)
+                    {
+                        continue;
+                    }
+                    return false;
+                }
+                data.remove_prefix(static_cast<size_t>(written));
+            }
+            return true;
+        }
+
+    } // !namespace
+
+    /// @brief A journal stored at path, not read or written until resume or start.
+    /// @param path[in] Where the journal lives, next to the partial file.
+    Journal::Journal(std::string path) : _path(std::move(path)) {}
+
+    Journal::~Journal()
+    {
+        close();
+    }
+
+    /// @brief Load the ranges an earlier attempt recorded for the same file.
+    /// @param size[in] The file size the server reports now.
+    /// @param validator[in] The ETag or Last-Modified the server reports now.
+    /// @return false if there is no journal or it describes another version
+    /// of the file, start a new one then.
+    bool Journal::resume(off_t size, const std::string &validator)
+    {
+        std::ifstream file(_path);
+        std::string magic, sizeLine, validatorLine;
+        if (!std::getline(file, magic) || magic != MAGIC ||
+            !std::getline(file, sizeLine) || !std::getline(file, validatorLine) ||
+            sizeLine != "size " + std::to_string(size) || validatorLine != "validator " + validator)
+        {
+            return false;
+        }
+
+        _size = size;
+        _done.clear();
+        std::string line;
+        while (std::getline(file, line))
+        {
+            // A torn line parses short or out of bounds and is dropped; a
+            // shortened end only claims less than is on disk
+            long long begin = 0, end = 0;
+            if (std::sscanf(line.c_str(), "%lld %lld", &begin, &end) == 2 &&
+                begin >= 0 && begin < end && end <= size)
+            {
+                merge(begin, end);
+            }
+        }
+        file.close();
+
+        _fd = ::open(_path.c_str(), O_WRONLY | O_APPEND | O_CLOEXEC);
+        if (_fd < 0)
+        {
+            _done.clear();
+            return false;
+        }
+        // End a torn last line, so the next record starts on its own line
+        writeAll(_fd, "\n");
+        return true;
+    }
+
+    /// @brief Replace the journal with an empty one for this file.
+    /// @param size[in] The file size.
+    /// @param validator[in] The ETag or Last-Modified of this version of the file.
+    /// @return false if the journal could not be written, the download then
+    /// cannot be resumed.
+    bool Journal::start(off_t size, const std::string &validator)
+    {
+        close();
+        _size = size;
+        _done.clear();
+
+        _fd = ::open(_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0644);
+        if (_fd < 0)
+        {
+            spdlog::warn("Could not create download journal {}: {}", _path, std::strerror(errno));
+            return false;
+        }
+
+        std::string header(MAGIC);
+        header += "\nsize " + std::to_string(size) + "\nvalidator " + validator + "\n";
+        if (!writeAll(_fd, header))
+        {
+            spdlog::warn("Could not write download journal {}: {}", _path, std::strerror(errno));
+            remove();
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Record that a byte range is on disk.
+    /// @param begin[in] First byte of the range.
+    /// @param end[in] One past its last byte.
+    /// @return none.
+    /// NOTE: the data is not synced first. A crash of the process keeps it
+    /// in the page cache, only a crash of the machine can lose it.
+    void Journal::record(off_t begin, off_t end)
+    {
+        if (_fd < 0 || begin >= end)
+        {
+            return;
+        }
+        merge(begin, end);
+        writeAll(_fd, std::to_string(begin) + " " + std::to_string(end) + "\n");
+    }
+
+    /// @brief Delete the journal, once the file is complete or cannot be resumed.
+    /// @param none.
+    /// @return none.
+    void Journal::remove()
+    {
+        close();
+        _done.clear();
+        ::unlink(_path.c_str());
+    }
+
+    /// @brief The byte ranges still to fetch.
+    /// @param none.
+    /// @return The holes between the recorded ranges, in file order.
+    std::vector<Range> Journal::missing() const
+    {
+        std::vector<Range> holes;
+        off_t position = 0;
+        for (const Range &range : _done)
+        {
+            if (range.begin > position)
+            {
+                holes.push_back({position, range.begin});
+            }
+            position = range.end;
+        }
+        if (position < _size)
+        {
+            holes.push_back({position, _size});
+        }
+        return holes;
+    }
+
+    /// @brief Bytes already on disk.
+    /// @param none.
+    /// @return The sum of the recorded ranges.
+    off_t Journal::completed() const
+    {
+        off_t total = 0;
+        for (const Range &range : _done)
+        {
+            total += range.end - range.begin;
+        }
+        return total;
+    }
+
+    /// @brief Add a range to the recorded ones, joining those it touches.
+    void Journal::merge(off_t begin, off_t end)
+    {
+        auto first = std::lower_bound(_done.begin(), _done.end(), begin,
+                                      [](const Range &range, off_t value)
+                                      { return range.end < value; });
+        auto last = first;
+        while (last != _done.end() && last->begin <= end)
+        {
+            begin = std::min(begin, last->begin);
+            end = std::max(end, last->end);
+            ++last;
+        }
+        first = _done.erase(first, last);
+        _done.insert(first, Range{begin, end});
+    }
+
+    void Journal::close()
+    {
+        if (_fd >= 0)
+        {
+            ::close(_fd);
+            _fd = -1;
+        }
+    }
+
+} // !namespace downloadJournal
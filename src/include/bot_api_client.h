@@ -0,0 +1,100 @@
+#ifndef BOT_API_CLIENT_H
+#define BOT_API_CLIENT_H
+
+/**
+ * @file bot_api_client.h
+ * @brief Non-blocking Telegram Bot API client.
+ *
+ * Requests run on one curl multi handle whose sockets and timer are
+ * watched by the server's io_context, so no thread ever blocks on a
+ * transfer. Requests to api.telegram.org are multiplexed over HTTP/2
+ * and every request has its own timeout.
+ */
+
+#include "header.h"
+
+namespace botApiClient
+{
+    class BotApiClient
+    {
+    public:
+        struct Response
+        {
+            CURLcode code = CURLE_OK;
+            long status = 0;
+            std::string body;
+
+            bool ok() const { return code == CURLE_OK && status == 200; }
+        };
+
+        /// NOTE: handlers run on the client's strand and must not block.
+        using Handler = std::function<void(Response)>;
+
+        BotApiClient(boost::asio::io_context &ioc,
+                     std::string baseUrl,
+                     std::chrono::milliseconds timeout = std::chrono::seconds(10));
+        ~BotApiClient();
+
+        void call(const std::string &method, std::string form, Handler handler,
+                  std::chrono::milliseconds timeout = std::chrono::milliseconds(0));
+        std::future<Response> call(const std::string &method, std::string form);
+
+    private:
+        BotApiClient(const BotApiClient &) = delete;
+        BotApiClient &operator=(const BotApiClient &) = delete;
+
+        struct Transfer
+        {
+            CURL *easy = nullptr;
+            std::string url;
+            std::string form;
+            long timeoutMs = 0;
+            Handler handler;
+            Response response;
+        };
+
+        struct Socket
+        {
+            explicit Socket(boost::asio::io_context &ioc, curl_socket_t fd)
+                : descriptor(ioc, fd) {}
+
+            /// NOTE: the socket belongs to curl, never let asio close it.
+            ~Socket() { descriptor.release(); }
+
+            boost::asio::posix::stream_descriptor descriptor;
+            int what = CURL_POLL_NONE;
+            bool reading = false;
+            bool writing = false;
+        };
+
+        void start(std::shared_ptr<Transfer> transfer);
+        void watch(curl_socket_t fd, int what);
+        void arm(const std::shared_ptr<Socket> &socket, curl_socket_t fd);
+        void onSocketReady(curl_socket_t fd, int flag);
+        void onTimeout();
+        void action(curl_socket_t fd, int flags);
+        void completeTransfers();
+
+        static int socketCallback(CURL *easy, curl_socket_t fd, int what,
+                                  void *userp, void *socketp);
+        static int timerCallback(CURLM *multi, long timeoutMs, void *userp);
+
+        boost::asio::io_context &_ioc;
+        boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+        boost::asio::steady_timer _timer;
+        const std::string _baseUrl;
+        const std::chrono::milliseconds _timeout;
+
+        CURLM *_multi;
+        int _running = 0;
+        std::map<curl_socket_t, std::shared_ptr<Socket>> _sockets;
+        std::map<CURL *, std::shared_ptr<Transfer>> _transfers;
+
+        std::atomic<std::uint64_t> &_inFlight;
+        std::atomic<std::uint64_t> &_completed;
+        std::atomic<std::uint64_t> &_failures;
+    };
+
+} // !namespace botApiClient
+
+#endif // !BOT_API_CLIENT_H
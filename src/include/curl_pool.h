@@ -0,0 +1,77 @@
+#ifndef CURL_POOL_H
+#define CURL_POOL_H
+
+/**
+ * @file curl_pool.h
+ * @brief Pool of reusable curl easy handles for outbound requests.
+ *
+ * Handles are leased per request and returned afterwards, so they keep
+ * their warm connections. All handles of a pool also share one curl
+ * share handle for the connection, DNS and TLS session caches. Reused
+ * and new connections are counted in the metrics registry. A pool can
+ * also use the share handle of another one, so the caches span pools.
+ */
+
+#include "header.h"
+
+namespace curlPool
+{
+    class CurlPool
+    {
+    public:
+        /// @brief Easy handle borrowed from the pool, returned on destruction.
+        class Lease
+        {
+        public:
+            Lease(CurlPool &pool, CURL *handle) : _pool(&pool), _handle(handle) {}
+            Lease(Lease &&other) noexcept : _pool(other._pool), _handle(other._handle) { other._handle = nullptr; }
+            Lease(const Lease &) = delete;
+            Lease &operator=(const Lease &) = delete;
+            ~Lease();
+
+            CURL *get() const { return _handle; }
+            explicit operator bool() const { return _handle != nullptr; }
+
+        private:
+            CurlPool *_pool;
+            CURL *_handle;
+        };
+
+        explicit CurlPool(const std::string &name, std::size_t maxIdle = 16,
+                          CurlPool *shareWith = nullptr);
+        ~CurlPool();
+
+        Lease acquire();
+        CURLcode perform(CURL *handle);
+
+        static size_t appendCallback(char *ptr, size_t size,
+                                     size_t nmemb, void *userdata);
+
+    private:
+        CurlPool(const CurlPool &) = delete;
+        CurlPool &operator=(const CurlPool &) = delete;
+
+        void release(CURL *handle);
+        void prepare(CURL *handle);
+
+        static void lockShare(CURL *handle, curl_lock_data data,
+                              curl_lock_access access, void *userptr);
+        static void unlockShare(CURL *handle, curl_lock_data data, void *userptr);
+
+        const std::size_t _maxIdle;
+        const bool _ownsShare;
+        CURLSH *_share;
+        std::mutex _shareLocks[CURL_LOCK_DATA_LAST];
+
+        std::mutex _mutex;
+        std::vector<CURL *> _idle;
+
+        std::atomic<std::uint64_t> &_requests;
+        std::atomic<std::uint64_t> &_newConnections;
+        std::atomic<std::uint64_t> &_reusedConnections;
+        std::atomic<std::uint64_t> &_failures;
+    };
+
+} // !namespace curlPool
+
+#endif // !CURL_POOL_H
@@ -0,0 +1,59 @@
+#ifndef DOWNLOAD_JOURNAL_H
+#define DOWNLOAD_JOURNAL_H
+
+/**
+ * @file download_journal.h
+ * @brief Sidecar record of the bytes a partial download already holds.
+ *
+ * The journal sits next to the partial file. Its header holds the file size
+ * and the server's validator (ETag or Last-Modified). It is followed by one
+ * "begin end" line for each checkpoint of a byte range written to disk.
+ * Lines are only appended, so a crash loses at most the last checkpoint. A
+ * later attempt that finds the same size and validator fetches only the
+ * missing ranges.
+ */
+
+#include "header.h"
+
+namespace downloadJournal
+{
+    /// @brief A byte range of the file, end exclusive.
+    struct Range
+    {
+        off_t begin = 0;
+        off_t end = 0;
+    };
+
+    class Journal
+    {
+    public:
+        explicit Journal(std::string path);
+        ~Journal();
+
+        bool resume(off_t size, const std::string &validator);
+        bool start(off_t size, const std::string &validator);
+        void record(off_t begin, off_t end);
+        void remove();
+
+        std::vector<Range> missing() const;
+        off_t completed() const;
+
+    private:
+        Journal(const Journal &) = delete;
+        Journal &operator=(const Journal &) = delete;
+
+        static constexpr std::string_view MAGIC = "sipeto-journal 1";
+
+        void merge(off_t begin, off_t end);
+        void close();
+
+        const std::string _path;
+        int _fd = -1;
+        off_t _size = 0;
+        /// Sorted, disjoint and not adjacent.
+        std::vector<Range> _done;
+    };
+
+} // !namespace downloadJournal
+
+#endif // !DOWNLOAD_JOURNAL_H
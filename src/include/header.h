@@ -45,6 +45,12 @@
 #include <condition_variable>
 #include <mutex>
 #include <chrono>
+#include <future>
+#include <deque>
+#include <charconv>
+#include <string_view>
+#include <unordered_map>
+#include <poll.h>
 #include <spdlog/spdlog.h>
 #include <boost/regex.hpp>
 #include <boost/beast.hpp>
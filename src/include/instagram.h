@@ -25,14 +25,12 @@ namespace instagram
         Instagram(const std::string &mediaUrl, Sipeto &sipeto);
 
         ReturnCode downloadMedia() override;
-        void getMediaAttributes(const std::string &url) override;
+        MediaInfo getMediaAttributes(const std::string &url) override;
 
         ~Instagram();
 
     private:
         Sipeto &_sipeto;
-        std::string downloadedData;
-        std::map<std::string, std::string> _attributes;
         static std::shared_ptr<spdlog::logger> _logger;
         std::string MEDIA_URL = "<insert_media_file_url_here>";
     };
@@ -0,0 +1,132 @@
+#ifndef JSON_PATH_H
+#define JSON_PATH_H
+
+/**
+ * @file json_path.h
+ * @brief Streaming extraction of a few paths from a JSON document.
+ *
+ * The document is fed in chunks as it arrives, e.g. from a curl write
+ * callback, and only the values at the requested paths are kept. Any
+ * subtree no path leads into is skipped by counting brackets, so a large
+ * response never becomes a DOM and is never buffered whole.
+ *
+ * Paths are dotted member names with array indices, "*" matches every
+ * member or element:
+ *     jsonPath::Extractor extractor;
+ *     const auto url = extractor.add("includes.media[0].url");
+ *     const auto errors = extractor.add("errors[*].message", false);
+ *     ... extractor.feed(data, size) for each chunk ...
+ *     if (const std::string *value = extractor.value(url)) ...
+ */
+
+#include "header.h"
+
+namespace jsonPath
+{
+    /// @brief One value found at a requested path.
+    struct Match
+    {
+        std::size_t path = 0;
+        /// Member name or array index the value was found under.
+        std::string key;
+        std::string value;
+        /// false for numbers, booleans and null, whose value is their raw text.
+        bool string = false;
+    };
+
+    std::uint32_t toUnsigned(std::string_view text);
+
+    class Extractor
+    {
+    public:
+        static constexpr std::size_t MAX_PATHS = 64;
+        static constexpr std::size_t MAX_VALUE = 1 << 20;
+
+        std::size_t add(std::string_view path, bool required = true);
+
+        bool feed(const char *data, std::size_t size);
+        bool finish();
+
+        bool complete() const;
+        bool failed() const { return _state == State::Error; }
+
+        const std::string *value(std::size_t path) const;
+        const std::vector<Match> &matches() const { return _matches; }
+
+        static size_t writeCallback(char *ptr, size_t size,
+                                    size_t nmemb, void *userdata);
+
+    private:
+        enum class State
+        {
+            Value,
+            FirstMemberOrEnd,
+            Member,
+            Colon,
+            FirstElementOrEnd,
+            CommaOrEnd,
+            String,
+            Escape,
+            Unicode,
+            Literal,
+            Skip,
+            End,
+            Error,
+        };
+
+        struct Segment
+        {
+            std::string key;
+            std::size_t index = 0;
+            bool isIndex = false;
+            bool wildcard = false;
+        };
+
+        struct Path
+        {
+            std::vector<Segment> segments;
+            std::size_t firstWildcard = std::string::npos;
+            bool required = true;
+            bool resolved = false;
+        };
+
+        /// @brief An object or array at least one path leads into.
+        struct Frame
+        {
+            bool array = false;
+            std::uint64_t paths = 0;
+            std::size_t index = 0;
+        };
+
+        bool beginValue(char c);
+        void endValue(bool string);
+        void closeFrame();
+        bool skip(const char *&p, const char *end);
+        bool appendUnit();
+        void appendCodePoint(std::uint32_t codePoint);
+        void flushSurrogate();
+        bool fail();
+
+        std::vector<Path> _paths;
+        std::vector<Frame> _frames;
+        std::vector<Match> _matches;
+        State _state = State::Value;
+
+        std::string _key;
+        std::string _buffer;
+        std::string *_target = nullptr;
+        bool _inKey = false;
+        std::uint64_t _capture = 0;
+
+        std::uint32_t _unit = 0;
+        std::uint32_t _highSurrogate = 0;
+        int _hexDigits = 0;
+
+        std::size_t _skipDepth = 0;
+        bool _skipInString = false;
+        bool _skipEscape = false;
+    };
+
+} // !namespace jsonPath
+
+#endif // !JSON_PATH_H
@@ -0,0 +1,24 @@
+#ifndef LINK_EXTRACTOR_H
+#define LINK_EXTRACTOR_H
+
+/**
+ * @file link_extractor.h
+ * @brief Pull the links out of a message through its entities.
+ *
+ * Telegram marks links as url entities, positioned in UTF-16 code
+ * units, or as text_link entities carrying the target URL. Entity
+ * offsets are mapped to UTF-8 byte offsets in one pass over the text,
+ * eight bytes at a time, so text with emoji or non-Latin script costs
+ * no per-character walk.
+ */
+
+#include "update_parser.h"
+
+namespace linkExtractor
+{
+    void utf16ToUtf8Offsets(std::string_view text, std::vector<std::size_t> &offsets);
+    std::size_t extractLinks(const updateParser::Message &message, std::vector<std::string_view> &links);
+
+} // !namespace linkExtractor
+
+#endif // !LINK_EXTRACTOR_H
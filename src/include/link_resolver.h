@@ -0,0 +1,62 @@
+#ifndef LINK_RESOLVER_H
+#define LINK_RESOLVER_H
+
+/**
+ * @file link_resolver.h
+ * @brief Resolves short links to their canonical media link.
+ *
+ * Only the redirect is needed, so each hop is a HEAD request and the
+ * target is read from its Location header; no page body is fetched.
+ * Resolved links are cached for a while, so a short link shared over
+ * and over resolves without any network traffic.
+ */
+
+#include "curl_pool.h"
+#include "url_router.h"
+
+namespace linkResolver
+{
+    class LinkResolver
+    {
+    public:
+        explicit LinkResolver(curlPool::CurlPool &shareWith,
+                              std::size_t maxHops = 5,
+                              std::chrono::seconds ttl = std::chrono::hours(6),
+                              std::size_t capacity = 4096);
+
+        std::string resolve(const std::string &url);
+
+    private:
+        struct Cached
+        {
+            std::string canonical;
+            std::chrono::steady_clock::time_point expires;
+        };
+
+        LinkResolver(const LinkResolver &) = delete;
+        LinkResolver &operator=(const LinkResolver &) = delete;
+
+        bool lookup(const std::string &url, std::string &canonical);
+        void store(const std::string &url, const std::string &canonical);
+        bool nextHop(const std::string &url, bool head, std::string &location, long &status);
+
+        static size_t discardBody(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+        const std::size_t _maxHops;
+        const std::chrono::seconds _ttl;
+        const std::size_t _capacity;
+
+        curlPool::CurlPool _pool;
+
+        std::mutex _mutex;
+        std::unordered_map<std::string, Cached> _cache;
+
+        std::atomic<std::uint64_t> &_hits;
+        std::atomic<std::uint64_t> &_misses;
+        std::atomic<std::uint64_t> &_hops;
+        std::atomic<std::uint64_t> &_failures;
+    };
+
+} // !namespace linkResolver
+
+#endif // !LINK_RESOLVER_H
@@ -0,0 +1,61 @@
+#ifndef LONG_POLLER_H
+#define LONG_POLLER_H
+
+/**
+ * @file long_poller.h
+ * @brief getUpdates long polling, the alternative to the webhook.
+ *
+ * Each batch is split into raw updates and queued for the same workers
+ * the webhook feeds, then the next poll is sent right away so it is in
+ * flight while the workers process the batch. The next offset is saved
+ * to a file before it is confirmed to Telegram, so a restart resumes
+ * where it stopped.
+ */
+
+#include "sipeto.h"
+
+namespace longPoller
+{
+    class LongPoller
+    {
+    public:
+        LongPoller(boost::asio::io_context &ioc,
+                   botApiClient::BotApiClient &client,
+                   sipeto::Sipeto &sipeto,
+                   std::size_t limit = 100,
+                   std::chrono::seconds timeout = std::chrono::seconds(30),
+                   std::string offsetFile = "sipeto.offset");
+
+        void start();
+        void stop();
+
+    private:
+        void poll();
+        void pollLater(std::chrono::milliseconds delay);
+        void onBatch(const botApiClient::BotApiClient::Response &response);
+
+        void loadOffset();
+        void storeOffset();
+
+        boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+        boost::asio::steady_timer _timer;
+        botApiClient::BotApiClient &_client;
+        sipeto::Sipeto &_sipeto;
+
+        const std::size_t _limit;
+        const std::chrono::seconds _timeout;
+        const std::string _offsetFile;
+
+        std::int64_t _offset = 0;
+        bool _stopped = false;
+        std::vector<updateParser::RawUpdate> _batch;
+
+        std::atomic<std::uint64_t> &_polls;
+        std::atomic<std::uint64_t> &_updates;
+        std::atomic<std::uint64_t> &_errors;
+        std::atomic<std::uint64_t> &_maxBatch;
+    };
+
+} // !namespace longPoller
+
+#endif // !LONG_POLLER_H
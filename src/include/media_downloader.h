@@ -2,14 +2,48 @@
 #define MEDIA_DOWNLOADER_H
 
 #include "header.h"
+#include "url_router.h"
+#include "json_path.h"
+#include "network_context.h"
+
+#include <boost/container/small_vector.hpp>
 
 namespace mediaDownloader
 {
+    enum class MediaType : std::uint8_t
+    {
+        Unknown,
+        Video,
+        Image,
+        AnimatedGif,
+        Audio,
+    };
+
+    /// @brief What a platform API says about one media item.
+    struct MediaInfo
+    {
+        MediaType type = MediaType::Unknown;
+        std::uint32_t width = 0;
+        std::uint32_t height = 0;
+        /// Bits per second, 0 when unknown.
+        std::uint32_t bitrate = 0;
+        std::uint32_t durationMs = 0;
+        std::string id;
+        std::string author;
+        std::string previewUrl;
+        /// Download addresses, best first. Rarely more than two.
+        boost::container::small_vector<std::string, 2> urls;
+
+        bool empty() const { return urls.empty(); }
+    };
+
+    MediaType mediaTypeOf(std::string_view name);
 
     class MediaDownloader
     {
     public:
         MediaDownloader(){};
+        explicit MediaDownloader(networkContext::NetworkContext &network) : _network(&network) {}
         ~MediaDownloader() = default;
 
         enum class ReturnCode
@@ -23,7 +57,7 @@ namespace mediaDownloader
 
         virtual ReturnCode downloadMedia() = 0;
         virtual std::map<std::string, std::string> &getTheMap() = 0;
-        virtual void getMediaAttributes(const std::string &url) = 0;
+        virtual MediaInfo getMediaAttributes(const std::string &url) = 0;
 
         virtual void loadConfigMap(const Json::Value &root, const std::string &socialMedia,
                                    std::map<std::string, std::string> &configMap);
@@ -31,14 +65,19 @@ namespace mediaDownloader
                                             const std::map<std::string, std::string> &configMap);
 
 
-        static size_t writeCallback(char *ptr,
-                                    size_t size,
-                                    size_t nmemb,
-                                    std::string *data);
-
         virtual std::string performHttpGetRequest(const std::string &url,
                                                   const std::string &bearerToken);
 
+        bool downloadToFile(const std::string &url, const std::string &path);
+
+        /// @brief Where downloadMedia stored the media, empty until it succeeded.
+        const std::string &downloadedPath() const { return _downloadedPath; }
+        MediaType downloadedType() const { return _downloadedType; }
+
+        bool performJsonRequest(const std::string &url,
+                                urlRouter::Platform platform,
+                                jsonPath::Extractor &extractor);
+
         std::string makeHttpRequest(const std::string &url,
                                     const std::string &method = "GET",
                                     const std::string &data = {},
@@ -59,6 +98,13 @@ namespace mediaDownloader
         }
 
     protected:
+        networkContext::NetworkContext &network() const;
+
+        /// NOTE: unset in downloaders only created to load their config.
+        networkContext::NetworkContext *_network = nullptr;
+        /// NOTE: set by downloadMedia once the file is complete.
+        std::string _downloadedPath;
+        MediaType _downloadedType = MediaType::Unknown;
         static std::shared_ptr<spdlog::logger> _logger;
         const std::map<std::string, std::string> _configMap;
     };
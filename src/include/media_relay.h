@@ -0,0 +1,101 @@
+#ifndef MEDIA_RELAY_H
+#define MEDIA_RELAY_H
+
+/**
+ * @file media_relay.h
+ * @brief Streams a media file from its CDN straight into a Bot API upload.
+ *
+ * The download and the multipart upload run at once on one curl multi
+ * handle, joined by a bounded ring buffer, and nothing touches the disk.
+ * A full buffer pauses the download and an empty one pauses the upload,
+ * so the faster side waits for the slower one. The file is sent in about
+ * the time of the slower transfer instead of the sum of both. Only files
+ * whose size is known up front and within the upload limit are relayed,
+ * since the multipart body declares its length.
+ */
+
+#include "curl_pool.h"
+#include "media_upload.h"
+
+namespace mediaRelay
+{
+    struct Limits
+    {
+        /// Bytes held between the two transfers.
+        std::size_t bufferSize = 1 << 20;
+        /// Largest file the Bot API accepts as an upload.
+        curl_off_t maxSize = 50ll << 20;
+    };
+
+    /// @brief Fixed-size byte FIFO between the two transfers.
+    class RingBuffer
+    {
+    public:
+        explicit RingBuffer(std::size_t capacity);
+
+        std::size_t write(const char *data, std::size_t size);
+        std::size_t read(char *data, std::size_t size);
+
+        std::size_t size() const { return _size; }
+        std::size_t capacity() const { return _data.size(); }
+        std::size_t space() const { return _data.size() - _size; }
+
+    private:
+        std::vector<char> _data;
+        std::size_t _head = 0;
+        std::size_t _size = 0;
+    };
+
+    class MediaRelay
+    {
+    public:
+        enum class Result
+        {
+            Sent,
+            /// Size unknown or over the limit, nothing was sent.
+            Skipped,
+            Failed
+        };
+
+        MediaRelay(curlPool::CurlPool &source, curlPool::CurlPool &telegram,
+                   std::string apiBase, Limits limits = {});
+
+        Result relay(const std::string &url, const mediaUpload::Request &request);
+
+    private:
+        /// @brief Where both transfers stand, shared by their callbacks.
+        struct State
+        {
+            explicit State(std::size_t capacity) : buffer(capacity) {}
+
+            RingBuffer buffer;
+            curl_off_t size = 0;
+            curl_off_t received = 0;
+            curl_off_t sent = 0;
+            /// Bytes of the chunk the paused download waits to hand over.
+            std::size_t pending = 0;
+            bool sourcePaused = false;
+            bool uploadPaused = false;
+            bool sourceDone = false;
+            bool sourceFailed = false;
+        };
+
+        bool transfer(CURL *source, CURL *upload, State &state, long &status);
+
+        static size_t writeSource(char *ptr, size_t size, size_t nmemb, void *userdata);
+        static size_t readUpload(char *buffer, size_t size, size_t nitems, void *userdata);
+
+        curlPool::CurlPool &_source;
+        curlPool::CurlPool &_telegram;
+        const std::string _apiBase;
+        const Limits _limits;
+
+        std::atomic<std::uint64_t> &_sent;
+        std::atomic<std::uint64_t> &_skipped;
+        std::atomic<std::uint64_t> &_failed;
+        std::atomic<std::uint64_t> &_bytes;
+    };
+
+} // !namespace mediaRelay
+
+#endif // !MEDIA_RELAY_H
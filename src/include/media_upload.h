@@ -0,0 +1,97 @@
+#ifndef MEDIA_UPLOAD_H
+#define MEDIA_UPLOAD_H
+
+/**
+ * @file media_upload.h
+ * @brief Sends media files to a chat with the Bot API send methods.
+ *
+ * The file part of the multipart/form-data body is filled by a curl mime
+ * read callback reading the file as curl sends it, so a file is never
+ * loaded into memory whatever its size. Progress and throughput are
+ * reported while the upload runs.
+ */
+
+#include "curl_pool.h"
+
+namespace mediaUpload
+{
+    enum class Kind : std::uint8_t
+    {
+        Video,
+        Photo,
+        Document,
+        Audio
+    };
+
+    /// @brief Bot API method of a kind of media and the form field of its file.
+    struct Method
+    {
+        std::string_view name;
+        std::string_view field;
+    };
+
+    Method methodOf(Kind kind);
+    std::string_view mimeTypeOf(std::string_view filename);
+
+    /// @brief What is sent, and to whom.
+    struct Request
+    {
+        std::string chatId;
+        Kind kind = Kind::Document;
+        std::string filename;
+        std::string mimeType;
+        std::string caption;
+    };
+
+    struct Progress
+    {
+        curl_off_t sent = 0;
+        curl_off_t total = 0;
+        /// Average since the upload started.
+        double bytesPerSecond = 0;
+    };
+
+    /// NOTE: runs on the uploading thread, between curl calls.
+    using ProgressHandler = std::function<void(const Progress &)>;
+
+    class MediaUploader
+    {
+    public:
+        MediaUploader(curlPool::CurlPool &telegram, std::string apiBase);
+
+        bool send(Request request, const std::string &path, ProgressHandler progress = {});
+
+        static curl_mime *buildForm(CURL *handle, const Request &request, curl_off_t size,
+                                    curl_read_callback read, curl_seek_callback seek, void *arg);
+
+    private:
+        /// Least time between two progress reports.
+        static constexpr auto REPORT_INTERVAL = std::chrono::seconds(1);
+
+        /// @brief The file being sent and the progress reports about it.
+        struct Source
+        {
+            int fd = -1;
+            curl_off_t offset = 0;
+            ProgressHandler progress;
+            std::chrono::steady_clock::time_point started;
+            std::chrono::steady_clock::time_point reported;
+            Progress last;
+        };
+
+        static size_t readFile(char *buffer, size_t size, size_t nitems, void *arg);
+        static int seekFile(void *arg, curl_off_t offset, int origin);
+        static int reportProgress(void *clientp, curl_off_t dltotal, curl_off_t dlnow,
+                                  curl_off_t ultotal, curl_off_t ulnow);
+
+        curlPool::CurlPool &_telegram;
+        const std::string _apiBase;
+
+        std::atomic<std::uint64_t> &_sent;
+        std::atomic<std::uint64_t> &_failed;
+        std::atomic<std::uint64_t> &_bytes;
+    };
+
+} // !namespace mediaUpload
+
+#endif // !MEDIA_UPLOAD_H
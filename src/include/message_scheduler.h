@@ -0,0 +1,109 @@
+#ifndef MESSAGE_SCHEDULER_H
+#define MESSAGE_SCHEDULER_H
+
+/**
+ * @file message_scheduler.h
+ * @brief Rate limited queue in front of outbound sendMessage calls.
+ *
+ * Telegram allows about one message per second to a chat and about
+ * thirty per second overall. Messages wait here until both the chat's
+ * and the global token bucket allow them, one request in flight per
+ * chat so replies keep their order. A 429 puts the chat on hold for
+ * retry_after seconds. Interactive replies go before bulk sends, and
+ * text queued for the same chat is merged into one message.
+ */
+
+#include "header.h"
+#include "bot_api_client.h"
+
+namespace messageScheduler
+{
+    enum class Priority
+    {
+        Interactive,
+        Bulk,
+    };
+
+    class TokenBucket
+    {
+    public:
+        TokenBucket(double rate, double burst);
+
+        bool take(std::chrono::steady_clock::time_point now);
+        bool full(std::chrono::steady_clock::time_point now);
+        std::chrono::steady_clock::duration wait(std::chrono::steady_clock::time_point now);
+
+    private:
+        void refill(std::chrono::steady_clock::time_point now);
+
+        double _rate;
+        double _burst;
+        double _tokens;
+        std::chrono::steady_clock::time_point _last;
+    };
+
+    class MessageScheduler
+    {
+    public:
+        MessageScheduler(boost::asio::io_context &ioc,
+                         botApiClient::BotApiClient &client,
+                         double chatRate = 1.0,
+                         double globalRate = 30.0,
+                         bool merge = true);
+
+        void send(std::string chatId, std::string text,
+                  Priority priority = Priority::Interactive);
+
+    private:
+        /// NOTE: Telegram rejects longer texts, so merging stops there.
+        static constexpr std::size_t MAX_TEXT_LENGTH = 4096;
+
+        struct Pending
+        {
+            std::string text;
+            Priority priority;
+        };
+
+        struct Chat
+        {
+            explicit Chat(double rate) : bucket(rate, 1.0) {}
+
+            TokenBucket bucket;
+            std::deque<Pending> queue;
+            std::chrono::steady_clock::time_point blockedUntil;
+            bool inFlight = false;
+            bool ready = false;
+        };
+
+        void enqueue(std::string chatId, std::string text, Priority priority);
+        void markReady(const std::string &chatId, Chat &chat);
+        void pump();
+        void dispatch(const std::string &chatId, Pending message);
+        void onSent(const std::string &chatId, Pending message,
+                    const botApiClient::BotApiClient::Response &response);
+
+        static long retryAfter(const std::string &body);
+        static std::string encodeForm(const std::string &value);
+
+        boost::asio::strand<boost::asio::io_context::executor_type> _strand;
+        boost::asio::steady_timer _timer;
+        botApiClient::BotApiClient &_client;
+
+        const double _chatRate;
+        const bool _merge;
+        TokenBucket _global;
+
+        std::unordered_map<std::string, Chat> _chats;
+        /// NOTE: chats with a sendable message, by the priority of their head.
+        std::deque<std::string> _interactive;
+        std::deque<std::string> _bulk;
+
+        std::atomic<std::uint64_t> &_queued;
+        std::atomic<std::uint64_t> &_sent;
+        std::atomic<std::uint64_t> &_merged;
+        std::atomic<std::uint64_t> &_throttled;
+    };
+
+} // !namespace messageScheduler
+
+#endif // !MESSAGE_SCHEDULER_H
@@ -0,0 +1,41 @@
+#ifndef METRICS_H
+#define METRICS_H
+
+/**
+ * @file metrics.h
+ * @brief Process-wide registry of named counters and gauges.
+ *
+ * Values are plain atomics: hot paths look a value up once, keep the
+ * reference and update it without locking. The registry renders all
+ * values in Prometheus text format for the /metrics endpoint.
+ */
+
+#include "header.h"
+
+namespace metrics
+{
+    class Metrics
+    {
+    public:
+        static Metrics &instance();
+
+        /// NOTE: the returned reference stays valid for the life of the process.
+        std::atomic<std::uint64_t> &get(const std::string &name);
+
+        /// @brief Raise a gauge to value if it is currently lower.
+        static void storeMax(std::atomic<std::uint64_t> &gauge, std::uint64_t value);
+
+        std::string render() const;
+
+    private:
+        Metrics() = default;
+        Metrics(const Metrics &) = delete;
+        Metrics &operator=(const Metrics &) = delete;
+
+        mutable std::mutex _mutex;
+        std::map<std::string, std::unique_ptr<std::atomic<std::uint64_t>>> _values;
+    };
+
+} // !namespace metrics
+
+#endif // !METRICS_H
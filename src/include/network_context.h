@@ -0,0 +1,65 @@
+#ifndef NETWORK_CONTEXT_H
+#define NETWORK_CONTEXT_H
+
+/**
+ * @file network_context.h
+ * @brief Outbound HTTP state shared by every downloader.
+ *
+ * libcurl is initialized once for the whole process when the context is
+ * created, before any thread runs a transfer, and cleaned up after the
+ * last pool is gone. All pools use one share handle, so DNS answers, TLS
+ * sessions and connections are reused across platforms. The request
+ * headers of each platform are built once from the config instead of
+ * on every request.
+ */
+
+#include "curl_pool.h"
+#include "link_resolver.h"
+#include "range_downloader.h"
+#include "url_router.h"
+
+namespace networkContext
+{
+    class NetworkContext
+    {
+    public:
+        NetworkContext();
+        ~NetworkContext();
+
+        void setHeaders(urlRouter::Platform platform, const std::vector<std::string> &lines);
+        curl_slist *headers(urlRouter::Platform platform) const;
+
+        /// NOTE: like the headers, only set before any request is made.
+        void setDownloadLimits(const rangeDownloader::Limits &limits) { _downloadLimits = limits; }
+        const rangeDownloader::Limits &downloadLimits() const { return _downloadLimits; }
+
+        curlPool::CurlPool &pool() { return _pool; }
+        linkResolver::LinkResolver &resolver() { return _resolver; }
+
+    private:
+        NetworkContext(const NetworkContext &) = delete;
+        NetworkContext &operator=(const NetworkContext &) = delete;
+
+        /// @brief Brackets the lifetime of every curl object of the context.
+        struct GlobalInit
+        {
+            GlobalInit();
+            ~GlobalInit();
+        };
+
+        static constexpr std::size_t PLATFORMS = static_cast<std::size_t>(urlRouter::Platform::Facebook) + 1;
+
+        /// NOTE: declared first, so curl is initialized before the pools
+        /// are created and cleaned up after they are destroyed.
+        GlobalInit _global;
+        curlPool::CurlPool _pool{"media"};
+        linkResolver::LinkResolver _resolver{_pool};
+
+        /// NOTE: set while the config is loaded, read-only once workers run.
+        std::array<curl_slist *, PLATFORMS> _headers{};
+        rangeDownloader::Limits _downloadLimits;
+    };
+
+} // !namespace networkContext
+
+#endif // !NETWORK_CONTEXT_H
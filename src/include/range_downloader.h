@@ -0,0 +1,116 @@
+#ifndef RANGE_DOWNLOADER_H
+#define RANGE_DOWNLOADER_H
+
+/**
+ * @file range_downloader.h
+ * @brief Downloads large files as parallel byte ranges.
+ *
+ * CDNs cap the throughput of each connection, so a large video is split
+ * into ranges fetched at once on pooled handles, all driven by one curl
+ * multi handle on the calling thread. The file is preallocated from the
+ * probed size and every range is written at its own offset. Servers that
+ * do not serve ranges get a single stream.
+ *
+ * A file the server can serve in ranges and tell apart from newer versions
+ * is fetched into "<path>.part". A download journal next to it records the
+ * ranges on disk. If the download fails, both are kept. The next attempt
+ * on the same path fetches only the missing ranges, as long as the server
+ * still reports the same size and validator. It sends If-Range, so a file
+ * that changed in between is fetched again in full.
+ */
+
+#include "curl_pool.h"
+#include "download_journal.h"
+#include "stream_sink.h"
+
+namespace rangeDownloader
+{
+    struct Limits
+    {
+        /// Most ranges fetched at once.
+        std::size_t maxSegments = 4;
+        /// Smallest range worth its own connection, in bytes.
+        std::uint64_t minSegmentSize = 2 << 20;
+    };
+
+    class RangeDownloader
+    {
+    public:
+        struct Probe
+        {
+            /// Where the redirects end, so ranges skip them.
+            std::string url;
+            curl_off_t size = -1;
+            bool ranges = false;
+            /// Strong ETag only, weak ones cannot be used with If-Range.
+            std::string etag;
+            std::string lastModified;
+
+            const std::string &validator() const { return etag.empty() ? lastModified : etag; }
+        };
+
+        explicit RangeDownloader(curlPool::CurlPool &pool, Limits limits = {});
+
+        bool download(const std::string &url, const std::string &path);
+        bool probe(const std::string &url, Probe &result);
+
+    private:
+        static constexpr int MAX_RETRIES = 2;
+        /// Bytes a range writes between two journal checkpoints.
+        static constexpr curl_off_t JOURNAL_STEP = 1 << 20;
+
+        enum class Result
+        {
+            Ok,
+            Failed,
+            /// The server answered a range with something else than it.
+            Rejected
+        };
+
+        /// @brief One byte range of the file and where its transfer stands.
+        struct Segment
+        {
+            CURL *handle = nullptr;
+            streamSink::StreamSink sink;
+            curl_off_t begin = 0;
+            /// Exclusive, -1 when the size is unknown.
+            curl_off_t end = -1;
+            /// Bytes taken from the transfer, some may still be in the sink.
+            curl_off_t written = 0;
+            /// Part of written already recorded in the journal.
+            curl_off_t journaled = 0;
+            downloadJournal::Journal *journal = nullptr;
+            curl_slist *headers = nullptr;
+            int retries = 0;
+            bool ranged = false;
+            bool checked = false;
+            bool rejected = false;
+        };
+
+        bool fetchResumable(const Probe &probe, const std::string &path, bool &rejected);
+        bool fetchSingle(const std::string &url, const std::string &path, curl_off_t sizeHint);
+        Result fetchSegments(const Probe &probe, int fd, std::vector<Segment> &segments,
+                             downloadJournal::Journal &journal);
+        bool fetchWhole(const std::string &url, int fd, curl_off_t &size);
+        std::vector<Segment> plan(const std::vector<downloadJournal::Range> &holes) const;
+        void start(Segment &segment, const std::string &url);
+        std::size_t segmentsFor(curl_off_t size) const;
+
+        static bool checkpoint(Segment &segment);
+        static size_t writeSegment(char *ptr, size_t size, size_t nmemb, void *userdata);
+        static size_t readHeader(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+        curlPool::CurlPool &_pool;
+        const Limits _limits;
+
+        std::atomic<std::uint64_t> &_segmented;
+        std::atomic<std::uint64_t> &_single;
+        std::atomic<std::uint64_t> &_fallbacks;
+        std::atomic<std::uint64_t> &_retries;
+        std::atomic<std::uint64_t> &_resumed;
+        std::atomic<std::uint64_t> &_bytes;
+    };
+
+} // !namespace rangeDownloader
+
+#endif // !RANGE_DOWNLOADER_H
@@ -18,55 +18,76 @@ namespace simpleHttpServer
     public:
         SimpleHttpServer(boost::asio::io_context &ioc,
                          const tcp::endpoint &endpoint,
-                         sipeto::Sipeto &sipeto);
+                         sipeto::Sipeto &sipeto,
+                         std::size_t threadCount = 1,
+                         bool reusePort = false);
         void run();
+        void stop();
         void start();
         void setwebHookUrl();
         void runSessionMethod();
         sipeto::Sipeto &_sipeto;
-        void handleSetWebHookUrlResponse();
+        void handleSetWebHookUrlResponse(const std::string &responseString);
 
         ~SimpleHttpServer()
         {
-            curl_global_cleanup();
+            stop();
         }
 
     private:
-        boost::asio::io_context _ioc;
+        /// NOTE: all I/O threads share this io_context; every session
+        /// gets its own strand so its handlers never run concurrently.
+        boost::asio::io_context &_ioc;
+        std::size_t _threadCount;
+        std::uint64_t _bodyLimit;
+        std::chrono::milliseconds _replyTimeout{0};
+        std::vector<std::thread> _threads;
+        std::unique_ptr<boost::asio::executor_work_guard<
+            boost::asio::io_context::executor_type>> _workGuard;
+
         class Session : public std::enable_shared_from_this<Session>
         {
         public:
             explicit Session(tcp::socket socket,
                              sipeto::Sipeto &sipeto,
-                             tcp::acceptor &acceptor);
+                             tcp::acceptor &acceptor,
+                             std::uint64_t bodyLimit,
+                             std::chrono::milliseconds replyTimeout);
 
             void start();
             void processTelegramUpdate();
 
         private:
             void readRequest();
+            void closeSocket();
             void handleRequest();
             void handleMethodNotAllowed();
+            void onRead(boost::system::error_code ec, std::size_t bytesTransferred);
             void handleRequestError(const std::string &errorMessage);
-            void writeResponse(const http::response<http::string_body> &response);
-
-            void doRead();
-
+            void writeWebhookReply(std::string method);
+            void writeResponse(http::response<http::string_body> &&response);
+            http::response<http::string_body> makeResponse(http::status status, bool keepAlive) const;
 
             tcp::socket _socket;
             sipeto::Sipeto &_sipeto;
             tcp::acceptor &_acceptor;
+            std::uint64_t _bodyLimit;
+            /// NOTE: zero disables inline webhook replies.
+            std::chrono::milliseconds _replyTimeout;
+            boost::asio::steady_timer _replyTimer;
             boost::beast::flat_buffer _buffer;
-            http::request<http::empty_body> _req;
+            std::optional<http::request_parser<http::string_body>> _parser;
+            http::request<http::string_body> _req;
             http::response<http::string_body> _res;
-            http::request<http::string_body> _reqString;
         };
 
-        void doAccept();
         void createSession();
+        void doAccept(tcp::acceptor &acceptor);
+        bool openAcceptor(tcp::acceptor &acceptor, const tcp::endpoint &endpoint, bool reusePort);
         std::stringstream _responseBuffer;
-        std::unique_ptr<tcp::acceptor> _acceptor; 
-        std::vector<std::shared_ptr<Session>> _sessions{};
+        /// NOTE: with SO_REUSEPORT there is one acceptor per I/O thread
+        /// and the kernel spreads incoming connections between them.
+        std::vector<std::unique_ptr<tcp::acceptor>> _acceptors;
         static size_t writeCallback(char *ptr, size_t size,
                                     size_t nmemb, void *userdata);
     };
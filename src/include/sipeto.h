@@ -27,6 +27,19 @@
 #ifndef SIPETO_H
 #define SIPETO_H
 
+#include "curl_pool.h"
+#include "network_context.h"
+#include "media_relay.h"
+#include "media_upload.h"
+#include "media_downloader.h"
+#include "bot_api_client.h"
+#include "message_scheduler.h"
+#include "update_queue.h"
+#include "update_dedup.h"
+#include "update_prefilter.h"
+#include "update_parser.h"
+#include "link_extractor.h"
+#include "string_switch.h"
 #include "simple_http_server.h"
 
 namespace sipeto
@@ -34,27 +47,40 @@ namespace sipeto
     using tcp = boost::asio::ip::tcp;
     namespace http = boost::beast::http;
 
-    /// NOTE: Keep this function as stand alone function
-    /// because it is used in a constexpr context.
-    /// the `this` pointer within a constexpr member
-    /// function is not allowed because `this`
-    /// is not a constant expression.
-    constexpr std::size_t hashString(const char *str);
-
     class Sipeto
     {
     public:
         explicit Sipeto(const std::string &configFile = "sipeto_config.json");
+        ~Sipeto();
 
         static std::map<std::string, std::string> _configMap;
 
         void loadConfig();
         void displayInfo();
         void setLogLevel(const std::string &level);
-        void processTelegramUpdate(const Json::Value &update);
-        void sendMessage(std::string chat_id, std::string text);
+        void processTelegramUpdate(const updateParser::Update &update);
+
+        /// NOTE: the update types processTelegramUpdate acts on, form-encoded
+        /// ["message","channel_post"] for the allowed_updates parameter of
+        /// setWebhook and getUpdates, so Telegram does not send the others.
+        static constexpr std::string_view _allowedUpdates = "%5B%22message%22%2C%22channel_post%22%5D";
+        bool wantsUpdate(std::string_view body);
+
+        /// Update workers, fed by the webhook sessions.
+        void stopWorkers();
+        void startWorkers(std::size_t count);
+        updateQueue::PushResult enqueueUpdate(std::string body,
+                                              std::shared_ptr<updateQueue::WebhookReply> reply = nullptr);
+        void sendMessage(std::string chat_id, std::string text,
+                         messageScheduler::Priority priority = messageScheduler::Priority::Interactive);
+
+        /// NOTE: outbound calls block on the curl pool until a client is set.
+        void setBotClient(botApiClient::BotApiClient *client) { _botClient = client; }
+        botApiClient::BotApiClient *getBotClient() const { return _botClient; }
+        void setMessageScheduler(messageScheduler::MessageScheduler *scheduler) { _scheduler = scheduler; }
         std::string processRequest(const std::string &requestBody);
         std::shared_ptr<spdlog::logger> getLogger() { return _logger; }
+        networkContext::NetworkContext &network() { return _network; }
 
         /// Methods to parse the configuration file.
         void parseConfig(const Json::Value &root);
@@ -63,17 +89,19 @@ namespace sipeto
         void parseArrayConfig(const Json::Value &arrayValue);
         void parseObjectConfig(const Json::Value &objectValue);
         void processConfigValue(const std::string &key, const Json::Value &value);
+        void configureNetwork();
 
-        /// NOTE: to load array related to each social media from config file.
-        const std::vector<std::string> _targetKeys = {"twitter", "tiktok", "instagram", "facebook"};
         const std::string &getFromConfigMap(const std::string &key, const std::map<std::string, std::string> &configMap = _configMap);
+        std::string getFromConfigMapOr(const std::string &key, const std::string &fallback) const;
 
-        /// NOTE: to map the key in the config file to the key in the config map.
-        std::unordered_map<std::string, std::string> _keyMap = {
+        /// NOTE: social media keys of the config file, mapped to their
+        /// section in the config map.
+        static constexpr auto _platforms = stringSwitch::makeStringMap<std::string_view>({
             {"tiktok", "TikTok"},
             {"twitter", "Twitter"},
             {"instagram", "Instagram"},
-            {"facebook", "Facebook"}};
+            {"facebook", "Facebook"},
+        });
 
         inline void loadConfigMap(const std::string &key, const std::string &value,
                                   std::map<std::string, std::string> &_configMap)
@@ -82,60 +110,61 @@ namespace sipeto
         }
 
     private:
-        struct User
-        {
-            int id;
-            std::string firsName;
-            std::string lastName;
-            std::string userName;
-        };
-
-        struct Chat
-        {
-            int id;
-            std::string type;
-            std::string title;
-            std::string userName;
-            std::string firstName;
-            std::string lastName;
-        };
-
-        struct Message
-        {
-            int messageId;
-            User from;
-            Chat chat;
-            int date;
-            std::string text;
-        };
-
-        struct Update
-        {
-            int updateId;
-            Message message;
-        };
+        using User = updateParser::User;
+        using Chat = updateParser::Chat;
+        using Message = updateParser::Message;
+        using Update = updateParser::Update;
+
+        /// Bot commands, dispatched by routeCommand.
+        using CommandHandler = void (Sipeto::*)(const Update &update, std::string_view args);
+        bool routeCommand(const Update &update);
+        void startCommand(const Update &update, std::string_view args);
+        void helpCommand(const Update &update, std::string_view args);
+        void downloadCommand(const Update &update, std::string_view args);
+        void downloadLinks(const Update &update, const std::vector<std::string_view> &links);
+        void downloadLink(const Update &update, std::string_view url);
+        bool relayMedia(const std::string &chatId, mediaDownloader::MediaDownloader &downloader,
+                        const std::string &link);
+        bool sendMedia(const std::string &chatId, const std::string &path, mediaDownloader::MediaType type);
+        std::string botApiBase();
 
         std::string encodeUrl(std::string str);
         void processUpdate(const Update &update);
-        std::vector<Update> parseUpdatesJson(Json::Value root);
         std::string makeRequest(std::string &url, std::string data = "");
         void handleRequest(http::request<http::string_body> &&req, tcp::socket &socket);
         void processTargetKeys(const Json::Value &configValue, const std::string &key);
         // void Sipeto::handleWebhookRequest(const HttpRequest &request, HttpResponse &response);
-        // Hash function for use with switch statement in setLogLevel()
-
-        static constexpr std::size_t hash(const char *s, std::size_t h = 0)
-        {
-            return (*s == '\0') ? h : hash(s + 1, (h * 31) + static_cast<unsigned char>(*s));
-        }
 
         std::string _configFile;
         static std::shared_ptr<spdlog::logger> _logger;
 
+        void workerLoop();
+
+        /// NOTE: webhook reply slot of the update the calling worker is processing.
+        static thread_local updateQueue::WebhookReply *_webhookReply;
+
         std::string receivedUpdate;
         bool isServerRunning = false;
         std::mutex receivedUpdateMutex;
 
+        /// NOTE: declared before every other curl user, see network_context.h.
+        networkContext::NetworkContext _network;
+        /// NOTE: warm connections to the Bot API, shared by every worker.
+        curlPool::CurlPool _telegramPool{"telegram", 16, &_network.pool()};
+        /// NOTE: set while the config is loaded, like the network context.
+        mediaRelay::Limits _relayLimits;
+        bool _relay = true;
+        botApiClient::BotApiClient *_botClient = nullptr;
+        messageScheduler::MessageScheduler *_scheduler = nullptr;
+
+        std::vector<std::thread> _workers;
+
+        /// NOTE: runs the links of one message in parallel while its worker waits.
+        std::unique_ptr<boost::asio::thread_pool> _linkPool;
+        std::unique_ptr<updateQueue::UpdateQueue> _updateQueue;
+        std::unique_ptr<updateDedup::DedupWindow> _seenUpdates;
+        bool _prefilter = true;
+
 #ifdef UNIT_TEST
         friend class SipetoTest;
 #endif
@@ -0,0 +1,56 @@
+#ifndef STREAM_SINK_H
+#define STREAM_SINK_H
+
+/**
+ * @file stream_sink.h
+ * @brief Writes a download to disk through one fixed-size buffer.
+ *
+ * curl hands a transfer over in chunks of at most 16 KiB. The sink gathers
+ * them in its buffer and writes the buffer at its file offset once it is
+ * full, so a download costs one buffer however large the file is, and one
+ * write call per buffer instead of per chunk. Buffers are taken from a
+ * small process-wide free list and returned to it, so sinks that come and
+ * go do not allocate each time.
+ */
+
+#include "header.h"
+
+namespace streamSink
+{
+    class StreamSink
+    {
+    public:
+        static constexpr std::size_t BUFFER_SIZE = 256 << 10;
+
+        StreamSink() = default;
+        StreamSink(int fd, off_t offset);
+        StreamSink(StreamSink &&other) noexcept;
+        StreamSink &operator=(StreamSink &&other) noexcept;
+        ~StreamSink();
+
+        bool write(const char *data, std::size_t size);
+        bool flush();
+
+        /// @brief Bytes written to the file so far, not counting the buffer.
+        std::uint64_t flushed() const { return _flushed; }
+
+        static size_t writeCallback(char *ptr, size_t size, size_t nmemb, void *userdata);
+
+    private:
+        StreamSink(const StreamSink &) = delete;
+        StreamSink &operator=(const StreamSink &) = delete;
+
+        bool writeAt(const char *data, std::size_t size);
+        void release();
+
+        int _fd = -1;
+        /// Where the buffer goes in the file.
+        off_t _offset = 0;
+        std::unique_ptr<char[]> _buffer;
+        std::size_t _used = 0;
+        std::uint64_t _flushed = 0;
+    };
+
+} // !namespace streamSink
+
+#endif // !STREAM_SINK_H
@@ -0,0 +1,149 @@
+#ifndef STRING_SWITCH_H
+#define STRING_SWITCH_H
+
+/**
+ * @file string_switch.h
+ * @brief Compile-time perfect hash maps from fixed strings to values.
+ *
+ * The table is built while compiling: a seed is searched for which the
+ * keys land in distinct slots, so a lookup is one hash, one slot and
+ * one string compare. Duplicate keys, or a key set no seed separates,
+ * stop the build instead of failing at run time.
+ *
+ * Usage:
+ *     static constexpr auto levels = stringSwitch::makeStringMap<Level>({
+ *         {"debug", Level::Debug},
+ *         {"info", Level::Info},
+ *     });
+ *     if (const Level *level = levels.find(name)) ...
+ */
+
+#include "header.h"
+
+namespace stringSwitch
+{
+    /// @brief Seeded FNV-1a hash, usable in constant expressions.
+    /// @param str[in] The string to hash.
+    /// @param seed[in] Mixed into the offset basis.
+    /// @return The hash value of the string.
+    constexpr std::uint64_t hash(std::string_view str, std::uint64_t seed = 0)
+    {
+        std::uint64_t hash = 14695981039346656037ULL ^ (seed * 0x9E3779B97F4A7C15ULL);
+        for (const char c : str)
+        {
+            hash ^= static_cast<unsigned char>(c);
+            hash *= 1099511628211ULL;
+        }
+        return hash ^ (hash >> 32);
+    }
+
+    template <typename Value>
+    struct Entry
+    {
+        std::string_view key;
+        Value value{};
+    };
+
+    template <typename Value, std::size_t N>
+    class StringMap
+    {
+    public:
+        /// NOTE: at least twice as many slots as keys keeps the seed search short.
+        static constexpr std::size_t SLOTS = [] {
+            std::size_t slots = 2;
+            while (slots < 2 * N)
+            {
+                slots <<= 1;
+            }
+            return slots;
+        }();
+
+        /// NOTE: only meant for constant evaluation, the throws turn a
+        /// duplicate key or an unseparable key set into a compile error.
+        constexpr explicit StringMap(const Entry<Value> (&entries)[N])
+        {
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                _entries[i] = entries[i];
+                for (std::size_t j = 0; j < i; ++j)
+                {
+                    if (entries[j].key == entries[i].key)
+                    {
+                        throw std::logic_error("stringSwitch: duplicate key");
+                    }
+                }
+            }
+
+            for (std::uint64_t seed = 0; seed < MAX_SEED; ++seed)
+            {
+                if (place(seed))
+                {
+                    _seed = seed;
+                    return;
+                }
+            }
+            throw std::logic_error("stringSwitch: no collision-free seed");
+        }
+
+        /// @brief Look a key up.
+        /// @param key[in] The string to look up.
+        /// @return The mapped value, nullptr if key is not in the map.
+        constexpr const Value *find(std::string_view key) const
+        {
+            const std::size_t index = _slots[hash(key, _seed) & (SLOTS - 1)];
+            if (index < N && _entries[index].key == key)
+            {
+                return &_entries[index].value;
+            }
+            return nullptr;
+        }
+
+        /// @brief Look a key up, falling back when it is not in the map.
+        constexpr Value valueOr(std::string_view key, Value fallback) const
+        {
+            const Value *value = find(key);
+            return value ? *value : fallback;
+        }
+
+        constexpr bool contains(std::string_view key) const { return find(key) != nullptr; }
+        constexpr const Entry<Value> *begin() const { return _entries; }
+        constexpr const Entry<Value> *end() const { return _entries + N; }
+
+    private:
+        static constexpr std::uint64_t MAX_SEED = 4096;
+
+        /// @brief Fill the slots for a seed.
+        /// @return false if two keys share a slot.
+        constexpr bool place(std::uint64_t seed)
+        {
+            for (auto &slot : _slots)
+            {
+                slot = N;
+            }
+            for (std::size_t i = 0; i < N; ++i)
+            {
+                std::size_t &slot = _slots[hash(_entries[i].key, seed) & (SLOTS - 1)];
+                if (slot != N)
+                {
+                    return false;
+                }
+                slot = i;
+            }
+            return true;
+        }
+
+        Entry<Value> _entries[N] = {};
+        std::size_t _slots[SLOTS] = {};
+        std::uint64_t _seed = 0;
+    };
+
+    /// @brief Build a map from a braced list of {key, value} pairs.
+    template <typename Value, std::size_t N>
+    constexpr StringMap<Value, N> makeStringMap(const Entry<Value> (&entries)[N])
+    {
+        return StringMap<Value, N>(entries);
+    }
+
+} // !namespace stringSwitch
+
+#endif // !STRING_SWITCH_H
@@ -15,33 +15,25 @@ namespace tiktok
     public:
         TikTok() = default;
 
-        TikTok(const std::string &mediaUrl)
-            : MEDIA_URL(mediaUrl), MediaDownloader()
+        TikTok(const std::string &mediaUrl, networkContext::NetworkContext &network)
+            : MediaDownloader(network), MEDIA_URL(mediaUrl)
         {
             _logger->debug("TikTok constructor");
         }
 
         ReturnCode downloadMedia() override;
-        void getMediaAttributes(const std::string &url) override;
-        std::string performHttpGetRequest(const std::string &itemId,
-                                          const std::string &bearerToken = " ") override;
+        MediaInfo getMediaAttributes(const std::string &url) override;
         inline std::map<std::string, std::string> &getTheMap() override { return _configMap; }
 
         std::string extractTiktokUrl(const std::string &html);
-        std::string downloadHttpsPage(const std::string &url);
+        bool downloadHttpsPage(const std::string &url, MediaInfo &media);
         std::string getVideoMetadata(const std::string &itemId,
                                      const std::string &bearerToken);
-        static size_t writeCallback(void *ptr, size_t size,
-                                    size_t nmemb, void *userdata);
-        static size_t writeFileCallback(void *contents, size_t size,
-                                        size_t nmemb, void *userp);
 
         ~TikTok();
 
     private:
-        std::string mediaType = "Unknown media type";
         static std::shared_ptr<spdlog::logger> _logger;
-        std::map<std::string, std::string> _attributes;
         static std::map<std::string, std::string> _configMap;
         std::string MEDIA_URL = "<insert_media_file_url_here>";
     };
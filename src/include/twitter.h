@@ -26,9 +26,7 @@ namespace twitter
     public:
         Twitter(const std::string &mediaUrl, Sipeto &sipeto);
 
-        void getMediaAttributes(const std::string &url) override;
-        std::string performHttpGetRequest(const std::string &url,
-                                          const std::string &bearerToken);
+        MediaInfo getMediaAttributes(const std::string &url) override;
 
         ReturnCode downloadMedia() override;
 
@@ -39,17 +37,11 @@ namespace twitter
         // std::string _bearerToken{"token"};
         const std::string &_mediaId{"id"};
         const std::string &_outputFilePath{"path"};
-        std::map<std::string, std::string> _attributes;
         static std::shared_ptr<spdlog::logger> _logger;
 
         std::string API_URL = "URL";
         std::string MEDIA_URL = "don't change this.";
 
-        static size_t writeCallback(char *ptr,
-                                    size_t size,
-                                    size_t nmemb,
-                                    std::string *data);
-
         /// TODO: to load array related to each social media from config file.
         std::map<std::string, std::string> _configMap;
 
@@ -0,0 +1,38 @@
+#ifndef UPDATE_DEDUP_H
+#define UPDATE_DEDUP_H
+
+/**
+ * @file update_dedup.h
+ * @brief Lock-free sliding window of recently seen update ids.
+ *
+ * Telegram redelivers an update when the webhook answers late or not
+ * at all. Update ids are sequential, so a ring of slots indexed by
+ * update_id remembers the last window's worth of them; an id already
+ * in its slot, or older than the one there, is a redelivery.
+ */
+
+#include "header.h"
+
+namespace updateDedup
+{
+    class DedupWindow
+    {
+    public:
+        explicit DedupWindow(std::size_t size = 4096);
+
+        bool insert(std::int64_t updateId);
+        void forget(std::int64_t updateId);
+
+    private:
+        std::atomic<std::int64_t> &slot(std::int64_t updateId);
+
+        const std::size_t _mask;
+        std::unique_ptr<std::atomic<std::int64_t>[]> _slots;
+
+        std::atomic<std::uint64_t> &_checked;
+        std::atomic<std::uint64_t> &_hits;
+    };
+
+} // !namespace updateDedup
+
+#endif // !UPDATE_DEDUP_H
@@ -0,0 +1,107 @@
+#ifndef UPDATE_PARSER_H
+#define UPDATE_PARSER_H
+
+/**
+ * @file update_parser.h
+ * @brief Typed, single-pass decoder for Telegram updates.
+ *
+ * The webhook body is scanned once and only the fields the bot uses
+ * are kept, everything else is skipped without being decoded. Strings
+ * are views into the body; only strings with escape sequences are
+ * decoded, into the update's own scratch buffer.
+ */
+
+#include "header.h"
+
+namespace updateParser
+{
+    enum class UpdateType
+    {
+        Unknown,
+        Message,
+        EditedMessage,
+        ChannelPost,
+        EditedChannelPost,
+        CallbackQuery,
+        InlineQuery,
+    };
+
+    struct User
+    {
+        std::int64_t id = 0;
+        std::string_view firstName;
+        std::string_view lastName;
+        std::string_view userName;
+    };
+
+    struct Chat
+    {
+        std::int64_t id = 0;
+        std::string_view type;
+        std::string_view title;
+        std::string_view userName;
+        std::string_view firstName;
+        std::string_view lastName;
+    };
+
+    enum class EntityType
+    {
+        Other,
+        Url,
+        TextLink,
+        BotCommand,
+    };
+
+    /// NOTE: offset and length count UTF-16 code units of the text, not bytes.
+    struct Entity
+    {
+        EntityType type = EntityType::Other;
+        std::int64_t offset = 0;
+        std::int64_t length = 0;
+        std::string_view url;
+    };
+
+    struct Message
+    {
+        std::int64_t messageId = 0;
+        User from;
+        Chat chat;
+        std::int64_t date = 0;
+        std::string_view text;
+        std::vector<Entity> entities;
+    };
+
+    /// NOTE: the views point into the parsed body and into scratch, the
+    /// body must outlive the update.
+    struct Update
+    {
+        std::int64_t updateId = 0;
+        UpdateType type = UpdateType::Unknown;
+        Message message;
+
+        /// Decoded escaped strings. Reserved to the body size before the
+        /// first write so it never reallocates under existing views.
+        std::string scratch;
+    };
+
+    /// @brief One update of a getUpdates batch, still undecoded.
+    struct RawUpdate
+    {
+        std::int64_t updateId = 0;
+        std::string_view body;
+    };
+
+    /// @brief What the queue needs to know about an update before it is processed.
+    struct UpdateKey
+    {
+        std::int64_t updateId = 0;
+        std::int64_t chatId = 0;
+    };
+
+    bool parseUpdate(std::string_view body, Update &update);
+    bool parseUpdateBatch(std::string_view body, std::vector<RawUpdate> &updates);
+    UpdateKey keyOf(std::string_view body);
+
+} // !namespace updateParser
+
+#endif // !UPDATE_PARSER_H
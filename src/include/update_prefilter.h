@@ -0,0 +1,23 @@
+#ifndef UPDATE_PREFILTER_H
+#define UPDATE_PREFILTER_H
+
+/**
+ * @file update_prefilter.h
+ * @brief Raw-byte test for updates the bot may act on.
+ *
+ * Most group updates are chatter without a link or a command. The
+ * raw body is searched for a supported host or a bot command before
+ * anything is decoded, so the rest can be acknowledged untouched.
+ * A match only means the update is worth decoding, not that it holds
+ * a usable link.
+ */
+
+#include "header.h"
+
+namespace updatePrefilter
+{
+    bool mayBeRelevant(std::string_view body);
+
+} // !namespace updatePrefilter
+
+#endif // !UPDATE_PREFILTER_H
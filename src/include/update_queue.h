@@ -0,0 +1,115 @@
+#ifndef UPDATE_QUEUE_H
+#define UPDATE_QUEUE_H
+
+/**
+ * @file update_queue.h
+ * @brief Bounded multi-producer/multi-consumer queue between the HTTP
+ * layer and the update workers.
+ *
+ * Sessions push raw update bodies and acknowledge the webhook right
+ * away; workers pop and process them. What happens when the queue is
+ * full is decided by the overflow policy.
+ *
+ * Updates carry the id of their chat as key. Updates of one chat are
+ * handed out one at a time, in arrival order, while updates of other
+ * chats go to any idle worker, so replies in a conversation are never
+ * reordered and a slow chat never holds back the others.
+ */
+
+#include "header.h"
+
+namespace updateQueue
+{
+    /// NOTE: Block stalls the pushing I/O thread until a worker frees a slot.
+    /// Shed drops the incoming update but still acknowledges it.
+    /// Reject refuses the update so the session answers 503 and Telegram retries.
+    enum class OverflowPolicy
+    {
+        Block,
+        Shed,
+        Reject,
+    };
+
+    /// NOTE: Duplicate is a redelivery of an update already accepted,
+    /// acknowledged like a shed one.
+    enum class PushResult
+    {
+        Queued,
+        Shed,
+        Duplicate,
+        Rejected,
+        Closed,
+    };
+
+    /// @brief One-shot slot for the webhook response of a queued update.
+    /// NOTE: the first reply made while the update is processed goes back
+    /// inline as a Bot API method call. Once the slot is closed (reply
+    /// sent, processing done or the session timed out) every later reply
+    /// goes through the outbound client.
+    class WebhookReply
+    {
+    public:
+        using Deliver = std::function<void(std::string)>;
+
+        explicit WebhookReply(Deliver deliver) : _deliver(std::move(deliver)) {}
+
+        bool offer(std::string method);
+        void close();
+
+    private:
+        std::mutex _mutex;
+        bool _closed = false;
+        Deliver _deliver;
+    };
+
+    /// NOTE: key 0 means no chat, such updates are not ordered.
+    struct UpdateTask
+    {
+        std::int64_t key = 0;
+        std::string body;
+        std::shared_ptr<WebhookReply> reply;
+        std::chrono::steady_clock::time_point enqueuedAt;
+    };
+
+    class UpdateQueue
+    {
+    public:
+        UpdateQueue(std::size_t capacity, OverflowPolicy policy);
+
+        PushResult push(std::int64_t key, std::string body, std::shared_ptr<WebhookReply> reply = nullptr);
+        bool pop(UpdateTask &task);
+        void done(std::int64_t key);
+        void close();
+
+        std::size_t depth() const;
+        static OverflowPolicy parsePolicy(const std::string &policy);
+
+    private:
+        const std::size_t _capacity;
+        const OverflowPolicy _policy;
+
+        mutable std::mutex _mutex;
+        std::condition_variable _notEmpty;
+        std::condition_variable _notFull;
+        std::deque<UpdateTask> _tasks;
+        std::size_t _size = 0;
+        bool _closed = false;
+
+        /// NOTE: one entry per chat with an update queued or being processed,
+        /// holding the chat's later updates until the current one is done.
+        std::unordered_map<std::int64_t, std::deque<UpdateTask>> _chats;
+
+        std::atomic<std::uint64_t> &_depth;
+        std::atomic<std::uint64_t> &_maxDepth;
+        std::atomic<std::uint64_t> &_enqueued;
+        std::atomic<std::uint64_t> &_dequeued;
+        std::atomic<std::uint64_t> &_shed;
+        std::atomic<std::uint64_t> &_rejected;
+        std::atomic<std::uint64_t> &_held;
+        std::atomic<std::uint64_t> &_waitMicros;
+        std::atomic<std::uint64_t> &_maxWaitMicros;
+    };
+
+} // !namespace updateQueue
+
+#endif // !UPDATE_QUEUE_H
@@ -0,0 +1,49 @@
+#ifndef URL_ROUTER_H
+#define URL_ROUTER_H
+
+/**
+ * @file url_router.h
+ * @brief Single-pass classification of social media links.
+ *
+ * The host is looked up in a compile-time table, then a hand-written
+ * matcher for that platform walks the path once and returns the media
+ * id and username as views into the link. Nothing is allocated or
+ * copied, and case is folded while comparing instead of on a copy.
+ */
+
+#include "header.h"
+
+namespace urlRouter
+{
+    enum class Platform
+    {
+        Unknown,
+        TikTok,
+        Twitter,
+        Instagram,
+        Facebook,
+    };
+
+    /// NOTE: Short links (vm.tiktok.com/...) only carry a code, the media
+    /// id is behind the redirect.
+    enum class LinkKind
+    {
+        Unknown,
+        Media,
+        ShortLink,
+    };
+
+    struct Route
+    {
+        Platform platform = Platform::Unknown;
+        LinkKind kind = LinkKind::Unknown;
+        std::string_view id;
+        std::string_view username;
+    };
+
+    Route route(std::string_view url);
+    std::string_view platformName(Platform platform);
+
+} // !namespace urlRouter
+
+#endif // !URL_ROUTER_H
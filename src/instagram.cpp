@@ -9,7 +9,7 @@ namespace instagram
     std::shared_ptr<spdlog::logger> Instagram::_logger = spdlog::stdout_color_mt("Instagram");
 
     Instagram::Instagram(const std::string &mediaUrl, Sipeto &sipeto)
-        : _sipeto(sipeto), MEDIA_URL(mediaUrl)
+        : MediaDownloader(sipeto.network()), _sipeto(sipeto), MEDIA_URL(mediaUrl)
     {
         _logger->debug("Instagram constructor");
     }
@@ -18,114 +18,75 @@ namespace instagram
     {
         _logger->debug("Downloading media.");
 
-        // Initialize libcurl
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        CURL *curl = curl_easy_init();
-
-        if (curl)
+        // Streamed to disk, memory does not grow with the size of the video
+        const std::string mediaUrl = _sipeto.getFromConfigMap("instagramMediaUrl"); // Video URL
+        const std::string filename = "<media-id>.mp4";
+        if (!downloadToFile(mediaUrl, filename))
         {
-            // Set the URL of the media to be downloaded
-            std::string mediaUrl = _sipeto.getFromConfigMap("instagramMediaUrl"); // Video URL
-            curl_easy_setopt(curl, CURLOPT_URL, mediaUrl.c_str());
-
-            // Set the callback function to receive the downloaded media data
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, MediaDownloader::writeCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &downloadedData);
-
-            // Set additional options for video download
-            curl_easy_setopt(curl, CURLOPT_FOLLOWLOCATION, 1L);
-            curl_easy_setopt(curl, CURLOPT_RANGE, "0-"); // Download entire video, starting from byte 0
-
-            // Perform the request
-            CURLcode res = curl_easy_perform(curl);
-            if (res != CURLE_OK)
-            {
-                _logger->error("Failed to download media: %s", curl_easy_strerror(res));
-                curl_easy_cleanup(curl);
-                curl_global_cleanup();
-                return ReturnCode::MediaDownloadError;
-            }
-
-            // Save the downloaded media to a file
-            std::string filename = "<media-id>.mp4";
-            std::ofstream file(filename, std::ios::binary);
-            file.write(downloadedData.c_str(), downloadedData.size());
-            file.close();
-
-            _logger->debug("Media downloaded successfully.");
-            curl_easy_cleanup(curl);
-            curl_global_cleanup();
-            return ReturnCode::Ok;
+            _logger->error("Failed to download media: {}", mediaUrl);
+            return ReturnCode::MediaDownloadError;
         }
 
-        _logger->error("Failed to initialize libcurl.");
-        curl_global_cleanup();
-        return ReturnCode::MediaDownloadError;
+        _downloadedPath = filename;
+        _downloadedType = MediaType::Video;
+        _logger->debug("Media downloaded successfully.");
+        return ReturnCode::Ok;
     } // !downloadMedia()
 
-    void Instagram::getMediaAttributes(const std::string &url)
+    MediaInfo Instagram::getMediaAttributes(const std::string &url)
     {
-        const std::string lowerUrl = boost::algorithm::to_lower_copy(url);
         _logger->debug("Getting media attributes for URL: {}", url);
 
-        // Define regular expression for an Instagram link
-        // std::regex instagramRegex(R"(https?://(?:www\.)?instagram\.com/(?:p|reel|tv)/([^\?/]+)(\?.*)?)", std::regex_constants::icase);
-        std::regex instagramRegex(R"(https?://(?:www\.)?instagram\.com/p/(\w+)/?)", std::regex_constants::icase);
+        MediaInfo media;
 
-        // Match the URL against the regular expression
-        std::smatch urlMatch;
-        if (!std::regex_search(url, urlMatch, instagramRegex))
+        const urlRouter::Route route = urlRouter::route(url);
+        if (route.platform != urlRouter::Platform::Instagram || route.kind != urlRouter::LinkKind::Media)
         {
             _logger->error("Invalid Instagram link: {}", url);
-            return;
-        }
-
-        // Ensure that the media ID is available in the matched group
-        if (urlMatch.size() < 2)
-        {
-            _logger->error("Could not extract media ID from URL: {}", lowerUrl);
-            return;
+            return media;
         }
 
-        const std::string mediaId = urlMatch[1];
-
-        // Log matched groups for debugging purposes
-        for (size_t i = 0; i < urlMatch.size(); ++i)
-        {
-            _logger->debug("Match {}: {}", i, urlMatch[i].str());
-        }
+        const std::string mediaId(route.id);
+        _logger->debug("Instagram media {}", mediaId);
 
         // Construct the URL for the Instagram API endpoint that returns media information
         // https://graph.instagram.com/{media-id}?fields={fields}&access_token={access-token}
         const std::string apiUrl("https://graph.instagram.com/" + mediaId + "?fields=id,media_type,media_url,thumbnail_url,permalink,timestamp&access_token=" + _sipeto.getFromConfigMap("instagramToken"));
 
-        // Make an HTTP request to the Instagram API to get the media information
-        const std::string responseData = MediaDownloader::performHttpGetRequest(apiUrl, "GET");
-        _logger->debug("Response data: {}", responseData);
-        exit(0);
+        // Only the fields below are kept, the rest of the response is skipped unparsed
+        jsonPath::Extractor extractor;
+        const std::size_t type = extractor.add("type");
+        const std::size_t thumbnail = extractor.add("thumbnail_url");
+        const std::size_t width = extractor.add("thumbnail_width");
+        const std::size_t height = extractor.add("thumbnail_height");
 
-        if (responseData.empty())
+        if (!performJsonRequest(apiUrl, urlRouter::Platform::Instagram, extractor))
         {
             _logger->error("Failed to get media attributes from Instagram API");
-            return;
+            return media;
         }
 
-        // Parse the JSON response from the Instagram API
-        Json::Value root;
-        Json::Reader reader;
-        if (!reader.parse(responseData, root))
+        // Store the media information in the record
+        media.id = mediaId;
+        if (const std::string *value = extractor.value(type))
         {
-            _logger->error("Failed to parse media attributes JSON data");
-            return;
+            media.type = mediaTypeOf(*value);
+        }
+        if (const std::string *value = extractor.value(thumbnail))
+        {
+            media.urls.push_back(*value);
+        }
+        if (const std::string *value = extractor.value(width))
+        {
+            media.width = jsonPath::toUnsigned(*value);
+        }
+        if (const std::string *value = extractor.value(height))
+        {
+            media.height = jsonPath::toUnsigned(*value);
         }
-
-        // Extract the media information from the JSON data and store it in the map
-        _attributes["type"] = root["type"].asString();
-        _attributes["url"] = root["thumbnail_url"].asString();
-        _attributes["width"] = std::to_string(root["thumbnail_width"].asInt());
-        _attributes["height"] = std::to_string(root["thumbnail_height"].asInt());
 
         _logger->debug("Finished getting media attributes for URL: {}", url);
+        return media;
     }
 
     Instagram::~Instagram()
@@ -0,0 +1,726 @@
+#include "include/json_path.h"
+
+namespace jsonPath
+{
+    namespace
+    {
+        bool isSpace(char c)
+        {
+            return c == ' ' || c == '\n' || c == '\r' || c == '\t';
+        }
+
+        bool isLiteral(char c)
+        {
+            return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+                   c == '-' || c == '+' || c == '.';
+        }
+
+        int hexValue(char c)
+        {
+            if (c >= '0' && c <= '9')
+            {
+                return c - '0';
+            }
+            if (c >= 'a' && c <= 'f')
+            {
+                return c - 'a' + 10;
+            }
+            if (c >= 'A' && c <= 'F')
+            {
+                return c - 'A' + 10;
+            }
+            return -1;
+        }
+
+        bool inMask(std::uint64_t mask, std::size_t path)
+        {
+            return (mask >> path) & 1;
+        }
+
+    } // !namespace
+
+    /// @brief Read a count such as a width or a duration from a number's raw text.
+    /// @param text[in] e.g. "1280" or "15.5".
+    /// @return The integer part, 0 if text is not a non-negative number or is too large.
+    std::uint32_t toUnsigned(std::string_view text)
+    {
+        std::uint32_t value = 0;
+        const auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+        return result.ec == std::errc() ? value : 0;
+    }
+
+    /// @brief Request a path.
+    /// @param path[in] e.g. "itemInfo.itemStruct.video.playAddr", "includes.media[0].url" or "errors[*].message".
+    /// @param required[in] Whether complete() waits for the path.
+    /// @return The path's index, for value().
+    /// NOTE: throws std::invalid_argument on a malformed path or too many paths.
+    std::size_t Extractor::add(std::string_view path, bool required)
+    {
+        if (_paths.size() == MAX_PATHS)
+        {
+            throw std::invalid_argument("jsonPath: too many paths");
+        }
+
+        Path parsed;
+        parsed.required = required;
+
+        std::size_t i = 0;
+        while (i < path.size())
+        {
+            Segment segment;
+            if (path[i] == '[')
+            {
+                const std::size_t close = path.find(']', i);
+                if (close == std::string_view::npos || close == i + 1)
+                {
+                    throw std::invalid_argument("jsonPath: unterminated index in " + std::string(path));
+                }
+
+                const std::string_view index = path.substr(i + 1, close - i - 1);
+                segment.isIndex = true;
+                if (index == "*")
+                {
+                    segment.wildcard = true;
+                }
+                else
+                {
+                    for (const char c : index)
+                    {
+                        if (c < '0' || c > '9')
+                        {
+                            throw std::invalid_argument("jsonPath: bad index in " + std::string(path));
+                        }
+                        segment.index = segment.index * 10 + static_cast<std::size_t>(c - '0');
+                    }
+                }
+                i = close + 1;
+            }
+            else
+            {
+                const std::size_t end = std::min(path.find_first_of(".[", i), path.size());
+                if (end == i)
+                {
+                    throw std::invalid_argument("jsonPath: empty member name in " + std::string(path));
+                }
+                segment.key = std::string(path.substr(i, end - i));
+                segment.wildcard = segment.key == "*";
+                i = end;
+            }
+
+            if (segment.wildcard && parsed.firstWildcard == std::string::npos)
+            {
+                parsed.firstWildcard = parsed.segments.size();
+            }
+            parsed.segments.push_back(std::move(segment));
+
+            if (i < path.size() && path[i] == '.')
+            {
+                if (++i == path.size())
+                {
+                    throw std::invalid_argument("jsonPath: trailing dot in " + std::string(path));
+                }
+            }
+        }
+
+        if (parsed.segments.empty())
+        {
+            throw std::invalid_argument("jsonPath: empty path");
+        }
+
+        _paths.push_back(std::move(parsed));
+        return _paths.size() - 1;
+    }
+
+    /// @brief Parse the next chunk of the document.
+    /// @param data[in] The chunk, it may end anywhere, even inside a string.
+    /// @param size[in] Size of the chunk.
+    /// @return false once the document is malformed.
+    bool Extractor::feed(const char *data, std::size_t size)
+    {
+        const char *p = data;
+        const char *const end = data + size;
+
+        while (p < end)
+        {
+            switch (_state)
+            {
+            case State::Skip:
+                skip(p, end);
+                continue;
+
+            case State::String:
+            {
+                // Copy plain runs whole, only quotes and escapes stop the scan
+                const char *const run = p;
+                while (p < end && *p != '"' && *p != '\\' && static_cast<unsigned char>(*p) >= 0x20)
+                {
+                    ++p;
+                }
+                if (p != run)
+                {
+                    flushSurrogate();
+                    if (_target)
+                    {
+                        if (_target->size() + static_cast<std::size_t>(p - run) > MAX_VALUE)
+                        {
+                            return fail();
+                        }
+                        _target->append(run, static_cast<std::size_t>(p - run));
+                    }
+                }
+                if (p == end)
+                {
+                    continue;
+                }
+
+                const char c = *p++;
+                if (c == '\\')
+                {
+                    _state = State::Escape;
+                }
+                else if (c != '"')
+                {
+                    return fail();
+                }
+                else
+                {
+                    flushSurrogate();
+                    if (_inKey)
+                    {
+                        _inKey = false;
+                        _state = State::Colon;
+                    }
+                    else
+                    {
+                        endValue(true);
+                    }
+                }
+                continue;
+            }
+
+            case State::Escape:
+            {
+                const char c = *p++;
+                char decoded;
+                switch (c)
+                {
+                case '"':
+                case '\\':
+                case '/':
+                    decoded = c;
+                    break;
+                case 'b':
+                    decoded = '\b';
+                    break;
+                case 'f':
+                    decoded = '\f';
+                    break;
+                case 'n':
+                    decoded = '\n';
+                    break;
+                case 'r':
+                    decoded = '\r';
+                    break;
+                case 't':
+                    decoded = '\t';
+                    break;
+                case 'u':
+                    _unit = 0;
+                    _hexDigits = 0;
+                    _state = State::Unicode;
+                    continue;
+                default:
+                    return fail();
+                }
+
+                flushSurrogate();
+                if (_target)
+                {
+                    if (_target->size() >= MAX_VALUE)
+                    {
+                        return fail();
+                    }
+                    _target->push_back(decoded);
+                }
+                _state = State::String;
+                continue;
+            }
+
+            case State::Unicode:
+            {
+                const int digit = hexValue(*p++);
+                if (digit < 0)
+                {
+                    return fail();
+                }
+                _unit = (_unit << 4) | static_cast<std::uint32_t>(digit);
+                if (++_hexDigits == 4)
+                {
+                    if (!appendUnit())
+                    {
+                        return fail();
+                    }
+                    _state = State::String;
+                }
+                continue;
+            }
+
+            case State::Literal:
+                if (isLiteral(*p))
+                {
+                    if (_capture)
+                    {
+                        if (_buffer.size() >= MAX_VALUE)
+                        {
+                            return fail();
+                        }
+                        _buffer.push_back(*p);
+                    }
+                    ++p;
+                }
+                else
+                {
+                    // The delimiter belongs to the enclosing container
+                    endValue(false);
+                }
+                continue;
+
+            case State::Error:
+                return false;
+
+            default:
+                break;
+            }
+
+            const char c = *p;
+            if (isSpace(c))
+            {
+                ++p;
+                continue;
+            }
+
+            switch (_state)
+            {
+            case State::Value:
+                ++p;
+                if (!beginValue(c))
+                {
+                    return fail();
+                }
+                break;
+
+            case State::FirstMemberOrEnd:
+            case State::Member:
+                ++p;
+                if (c == '"')
+                {
+                    _key.clear();
+                    _target = &_key;
+                    _inKey = true;
+                    _state = State::String;
+                }
+                else if (c == '}' && _state == State::FirstMemberOrEnd)
+                {
+                    closeFrame();
+                }
+                else
+                {
+                    return fail();
+                }
+                break;
+
+            case State::Colon:
+                ++p;
+                if (c != ':')
+                {
+                    return fail();
+                }
+                _state = State::Value;
+                break;
+
+            case State::FirstElementOrEnd:
+                if (c == ']')
+                {
+                    ++p;
+                    closeFrame();
+                }
+                else
+                {
+                    _state = State::Value;
+                }
+                break;
+
+            case State::CommaOrEnd:
+            {
+                ++p;
+                Frame &frame = _frames.back();
+                if (c == ',')
+                {
+                    if (frame.array)
+                    {
+                        ++frame.index;
+                        _state = State::Value;
+                    }
+                    else
+                    {
+                        _state = State::Member;
+                    }
+                }
+                else if (c == (frame.array ? ']' : '}'))
+                {
+                    closeFrame();
+                }
+                else
+                {
+                    return fail();
+                }
+                break;
+            }
+
+            default:
+                // Anything after the document
+                return fail();
+            }
+        }
+
+        return true;
+    }
+
+    /// @brief Signal the end of the document.
+    /// @param none.
+    /// @return true if a whole document was parsed.
+    bool Extractor::finish()
+    {
+        if (_state == State::Literal && _frames.empty())
+        {
+            endValue(false);
+        }
+        return _state == State::End;
+    }
+
+    /// @brief Whether every required path was found or can no longer be found.
+    /// @param none.
+    /// @return true once the rest of the document is not needed.
+    bool Extractor::complete() const
+    {
+        if (_state == State::End)
+        {
+            return true;
+        }
+        for (const auto &path : _paths)
+        {
+            if (path.required && !path.resolved)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief The first value found at a path.
+    /// @param path[in] Index returned by add().
+    /// @return The value, nullptr if the path was not found.
+    const std::string *Extractor::value(std::size_t path) const
+    {
+        for (const auto &match : _matches)
+        {
+            if (match.path == path)
+            {
+                return &match.value;
+            }
+        }
+        return nullptr;
+    }
+
+    /// @brief curl write callback feeding an Extractor passed as userdata.
+    /// @return 0 to stop the transfer once the document is malformed or
+    /// complete, surfacing as CURLE_WRITE_ERROR.
+    size_t Extractor::writeCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        auto *extractor = static_cast<Extractor *>(userdata);
+        const size_t bytes = size * nmemb;
+        if (!extractor->feed(ptr, bytes) || extractor->complete())
+        {
+            return 0;
+        }
+        return bytes;
+    }
+
+    /// @brief Start the value whose first character is c.
+    /// @param c[in] The first character.
+    /// @return false if c cannot start a value.
+    bool Extractor::beginValue(char c)
+    {
+        std::uint64_t next = 0;
+        std::uint64_t terminal = 0;
+
+        if (_frames.empty())
+        {
+            next = _paths.size() == MAX_PATHS ? ~std::uint64_t(0) : (std::uint64_t(1) << _paths.size()) - 1;
+        }
+        else
+        {
+            const Frame &parent = _frames.back();
+            const std::size_t depth = _frames.size() - 1;
+            for (std::size_t i = 0; i < _paths.size(); ++i)
+            {
+                if (!inMask(parent.paths, i))
+                {
+                    continue;
+                }
+
+                const Segment &segment = _paths[i].segments[depth];
+                const bool matches = segment.wildcard ||
+                                     (parent.array ? segment.isIndex && segment.index == parent.index
+                                                   : !segment.isIndex && segment.key == _key);
+                if (matches)
+                {
+                    (_paths[i].segments.size() == depth + 1 ? terminal : next) |= std::uint64_t(1) << i;
+                }
+            }
+        }
+
+        if (c == '{' || c == '[')
+        {
+            // Only scalars are materialized, a path ending on a container finds nothing
+            for (std::size_t i = 0; i < _paths.size(); ++i)
+            {
+                if (inMask(terminal, i) && _paths[i].firstWildcard == std::string::npos)
+                {
+                    _paths[i].resolved = true;
+                }
+            }
+
+            if (next)
+            {
+                _frames.push_back(Frame{c == '[', next, 0});
+                _state = c == '[' ? State::FirstElementOrEnd : State::FirstMemberOrEnd;
+            }
+            else
+            {
+                _skipDepth = 1;
+                _skipInString = false;
+                _skipEscape = false;
+                _state = State::Skip;
+            }
+            return true;
+        }
+
+        _capture = terminal;
+        _buffer.clear();
+
+        if (c == '"')
+        {
+            _target = terminal ? &_buffer : nullptr;
+            _inKey = false;
+            _state = State::String;
+            return true;
+        }
+
+        if (c == '-' || (c >= '0' && c <= '9') || c == 't' || c == 'f' || c == 'n')
+        {
+            _buffer.push_back(c);
+            _state = State::Literal;
+            return true;
+        }
+
+        return false;
+    }
+
+    /// @brief Record the value just parsed and move on to its container.
+    /// @param string[in] Whether the value was a string.
+    /// @return none.
+    void Extractor::endValue(bool string)
+    {
+        if (_capture)
+        {
+            std::string key;
+            if (!_frames.empty())
+            {
+                key = _frames.back().array ? std::to_string(_frames.back().index) : _key;
+            }
+
+            for (std::size_t i = 0; i < _paths.size(); ++i)
+            {
+                if (!inMask(_capture, i))
+                {
+                    continue;
+                }
+                _matches.push_back(Match{i, key, _buffer, string});
+                if (_paths[i].firstWildcard == std::string::npos)
+                {
+                    _paths[i].resolved = true;
+                }
+            }
+            _capture = 0;
+        }
+
+        _target = nullptr;
+        _state = _frames.empty() ? State::End : State::CommaOrEnd;
+    }
+
+    /// @brief Leave the innermost object or array.
+    /// @param none.
+    /// @return none.
+    /// NOTE: a path is settled once the container it was looked for in
+    /// closes, unless a wildcard before it can still lead to another one.
+    void Extractor::closeFrame()
+    {
+        const Frame frame = _frames.back();
+        const std::size_t depth = _frames.size() - 1;
+        _frames.pop_back();
+
+        for (std::size_t i = 0; i < _paths.size(); ++i)
+        {
+            if (inMask(frame.paths, i) &&
+                (_paths[i].firstWildcard == std::string::npos || _paths[i].firstWildcard >= depth))
+            {
+                _paths[i].resolved = true;
+            }
+        }
+
+        endValue(false);
+    }
+
+    /// @brief Skip a container no path leads into, only counting brackets.
+    /// @param p[in,out] Position in the chunk, advanced past what was skipped.
+    /// @param end[in] End of the chunk.
+    /// @return true once the container is closed.
+    bool Extractor::skip(const char *&p, const char *end)
+    {
+        while (p < end)
+        {
+            if (_skipInString)
+            {
+                if (_skipEscape)
+                {
+                    _skipEscape = false;
+                    ++p;
+                    continue;
+                }
+                while (p < end && *p != '"' && *p != '\\')
+                {
+                    ++p;
+                }
+                if (p == end)
+                {
+                    break;
+                }
+                _skipEscape = *p == '\\';
+                _skipInString = _skipEscape;
+                ++p;
+                continue;
+            }
+
+            switch (*p++)
+            {
+            case '"':
+                _skipInString = true;
+                break;
+            case '{':
+            case '[':
+                ++_skipDepth;
+                break;
+            case '}':
+            case ']':
+                if (--_skipDepth == 0)
+                {
+                    endValue(false);
+                    return true;
+                }
+                break;
+            default:
+                break;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Append the \\u escape just read, pairing surrogates.
+    /// @param none.
+    /// @return false if the value grew too large.
+    bool Extractor::appendUnit()
+    {
+        if (_unit >= 0xD800 && _unit <= 0xDBFF)
+        {
+            flushSurrogate();
+            _highSurrogate = _unit;
+        }
+        else if (_unit >= 0xDC00 && _unit <= 0xDFFF)
+        {
+            if (_highSurrogate)
+            {
+                appendCodePoint(0x10000 + ((_highSurrogate - 0xD800) << 10) + (_unit - 0xDC00));
+                _highSurrogate = 0;
+            }
+            else
+            {
+                appendCodePoint(0xFFFD);
+            }
+        }
+        else
+        {
+            flushSurrogate();
+            appendCodePoint(_unit);
+        }
+        return !_target || _target->size() <= MAX_VALUE;
+    }
+
+    /// @brief Append a code point as UTF-8.
+    /// @param codePoint[in] The code point.
+    /// @return none.
+    void Extractor::appendCodePoint(std::uint32_t codePoint)
+    {
+        if (!_target)
+        {
+            return;
+        }
+
+        if (codePoint < 0x80)
+        {
+            _target->push_back(static_cast<char>(codePoint));
+        }
+        else if (codePoint < 0x800)
+        {
+            _target->push_back(static_cast<char>(0xC0 | (codePoint >> 6)));
+            _target->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else if (codePoint < 0x10000)
+        {
+            _target->push_back(static_cast<char>(0xE0 | (codePoint >> 12)));
+            _target->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            _target->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+        else
+        {
+            _target->push_back(static_cast<char>(0xF0 | (codePoint >> 18)));
+            _target->push_back(static_cast<char>(0x80 | ((codePoint >> 12) & 0x3F)));
+            _target->push_back(static_cast<char>(0x80 | ((codePoint >> 6) & 0x3F)));
+            _target->push_back(static_cast<char>(0x80 | (codePoint & 0x3F)));
+        }
+    }
+
+    /// @brief Replace a high surrogate that was not followed by a low one.
+    /// @param none.
+    /// @return none.
+    void Extractor::flushSurrogate()
+    {
+        if (_highSurrogate)
+        {
+            _highSurrogate = 0;
+            appendCodePoint(0xFFFD);
+        }
+    }
+
+    /// @brief Stop parsing for good.
+    /// @param none.
+    /// @return false, for returning straight from feed().
+    bool Extractor::fail()
+    {
+        _state = State::Error;
+        _capture = 0;
+        _target = nullptr;
+        return false;
+    }
+
+} // !namespace jsonPath
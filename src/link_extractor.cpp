@@ -0,0 +1,137 @@
+#include "include/link_extractor.h"
+
+namespace linkExtractor
+{
+    namespace
+    {
+        constexpr std::uint64_t HIGH_BITS = 0x8080808080808080ULL;
+        constexpr std::uint64_t LOW_BYTES = 0x0101010101010101ULL;
+
+        /// @brief Count the bytes with bit 7 set, summing them in the top byte.
+        inline std::size_t countHigh(std::uint64_t bits)
+        {
+            return static_cast<std::size_t>(((bits >> 7) * LOW_BYTES) >> 56);
+        }
+
+        /// @brief UTF-16 code units encoded by the lead bytes of eight UTF-8 bytes.
+        /// NOTE: every byte but a continuation byte (10xxxxxx) starts one unit,
+        /// a four-byte lead (11110xxx) starts a surrogate pair. The shifts
+        /// move bits 6, 5 and 4 of each byte up to bit 7 of the same byte.
+        inline std::size_t utf16Units(std::uint64_t word)
+        {
+            const std::uint64_t continuation = word & ~(word << 1) & HIGH_BITS;
+            const std::uint64_t fourByteLead = word & (word << 1) & (word << 2) & (word << 3) & HIGH_BITS;
+            return 8 - countHigh(continuation) + countHigh(fourByteLead);
+        }
+
+        inline std::size_t utf16Units(unsigned char c)
+        {
+            return ((c & 0xC0) != 0x80) + (c >= 0xF0);
+        }
+    }
+
+    /// @brief Map UTF-16 offsets into a UTF-8 text to byte offsets.
+    /// @param text[in] The UTF-8 text.
+    /// @param offsets[in,out] Sorted UTF-16 offsets, replaced by byte offsets.
+    /// Offsets past the end map to the text size.
+    /// @return none.
+    void utf16ToUtf8Offsets(std::string_view text, std::vector<std::size_t> &offsets)
+    {
+        const char *data = text.data();
+        const std::size_t size = text.size();
+
+        std::size_t byte = 0;
+        std::size_t unit = 0;
+        for (auto &offset : offsets)
+        {
+            // Whole words while the target is not inside them
+            while (byte + 8 <= size)
+            {
+                std::uint64_t word;
+                std::memcpy(&word, data + byte, sizeof(word));
+                const std::size_t units = utf16Units(word);
+                if (unit + units > offset)
+                {
+                    break;
+                }
+                unit += units;
+                byte += 8;
+            }
+
+            while (byte < size && unit < offset)
+            {
+                unit += utf16Units(static_cast<unsigned char>(data[byte++]));
+            }
+            // Land on the start of the next character
+            while (byte < size && (static_cast<unsigned char>(data[byte]) & 0xC0) == 0x80)
+            {
+                ++byte;
+            }
+            offset = byte;
+        }
+    }
+
+    /// @brief Collect the links of a message.
+    /// @param message[in] The decoded message.
+    /// @param links[out] Links in entity order, appended. Views into the update.
+    /// @return Number of links appended.
+    std::size_t extractLinks(const updateParser::Message &message, std::vector<std::string_view> &links)
+    {
+        using updateParser::EntityType;
+
+        // Both ends of each url entity, sorted for the single mapping pass
+        thread_local std::vector<std::size_t> bounds;
+        thread_local std::vector<std::size_t> order;
+        bounds.clear();
+        for (const auto &entity : message.entities)
+        {
+            if (entity.type == EntityType::Url && entity.offset >= 0 && entity.length > 0)
+            {
+                bounds.push_back(static_cast<std::size_t>(entity.offset));
+                bounds.push_back(static_cast<std::size_t>(entity.offset + entity.length));
+            }
+        }
+
+        order.resize(bounds.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            order[i] = i;
+        }
+        // Telegram sends entities sorted, so this is normally already in order
+        if (!std::is_sorted(bounds.begin(), bounds.end()))
+        {
+            std::sort(order.begin(), order.end(), [](std::size_t a, std::size_t b)
+                      { return bounds[a] < bounds[b]; });
+        }
+
+        thread_local std::vector<std::size_t> mapped;
+        mapped.resize(bounds.size());
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            mapped[i] = bounds[order[i]];
+        }
+        utf16ToUtf8Offsets(message.text, mapped);
+        for (std::size_t i = 0; i < order.size(); ++i)
+        {
+            bounds[order[i]] = mapped[i];
+        }
+
+        const std::size_t before = links.size();
+        std::size_t bound = 0;
+        for (const auto &entity : message.entities)
+        {
+            if (entity.type == EntityType::Url && entity.offset >= 0 && entity.length > 0)
+            {
+                const std::size_t begin = bounds[bound++];
+                const std::size_t end = bounds[bound++];
+                links.push_back(message.text.substr(begin, end - begin));
+            }
+            else if (entity.type == EntityType::TextLink && !entity.url.empty())
+            {
+                links.push_back(entity.url);
+            }
+        }
+        return links.size() - before;
+    }
+
+} // !namespace linkExtractor
@@ -0,0 +1,162 @@
+#include "include/metrics.h"
+#include "include/link_resolver.h"
+
+namespace linkResolver
+{
+    using metrics::Metrics;
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Create the resolver.
+    /// @param shareWith[in] Pool whose DNS, TLS and connection caches are used.
+    /// @param maxHops[in] Redirects followed before giving up.
+    /// @param ttl[in] How long a resolved link is kept.
+    /// @param capacity[in] Most links kept at once.
+    LinkResolver::LinkResolver(curlPool::CurlPool &shareWith, std::size_t maxHops,
+                               std::chrono::seconds ttl, std::size_t capacity)
+        : _maxHops(maxHops),
+          _ttl(ttl),
+          _capacity(std::max<std::size_t>(capacity, 1)),
+          _pool("resolver", 16, &shareWith),
+          _hits(Metrics::instance().get("resolver_cache_hits_total")),
+          _misses(Metrics::instance().get("resolver_cache_misses_total")),
+          _hops(Metrics::instance().get("resolver_hops_total")),
+          _failures(Metrics::instance().get("resolver_failures_total")) {}
+
+    /// @brief Follow a link's redirects until they reach a media link.
+    /// @param url[in] A short link.
+    /// @return The canonical media link, empty if it could not be resolved.
+    std::string LinkResolver::resolve(const std::string &url)
+    {
+        std::string canonical;
+        if (lookup(url, canonical))
+        {
+            _hits.fetch_add(1, std::memory_order_relaxed);
+            return canonical;
+        }
+        _misses.fetch_add(1, std::memory_order_relaxed);
+
+        std::string current = url;
+        for (std::size_t hop = 0; hop < _maxHops; ++hop)
+        {
+            std::string location;
+            long status = 0;
+            // Some hosts refuse HEAD, those get a GET that stops at the headers
+            if (!nextHop(current, true, location, status) ||
+                (location.empty() && (status == 405 || status == 403)))
+            {
+                if (!nextHop(current, false, location, status))
+                {
+                    break;
+                }
+            }
+            _hops.fetch_add(1, std::memory_order_relaxed);
+
+            if (location.empty())
+            {
+                break;
+            }
+            current = std::move(location);
+
+            if (urlRouter::route(current).kind == urlRouter::LinkKind::Media)
+            {
+                store(url, current);
+                return current;
+            }
+        }
+
+        _failures.fetch_add(1, std::memory_order_relaxed);
+        spdlog::error("Could not resolve short link {}", url);
+        return {};
+    }
+
+    /// @brief Request one hop without following it.
+    /// @param url[in] The link to request.
+    /// @param head[in] Send HEAD, or GET aborted once the headers are in.
+    /// @param location[out] The redirect target, empty if not redirected.
+    /// @param status[out] The response status.
+    /// @return false if no response was received.
+    bool LinkResolver::nextHop(const std::string &url, bool head, std::string &location, long &status)
+    {
+        auto curl = _pool.acquire();
+        if (!curl)
+        {
+            return false;
+        }
+
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 0L);
+        curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, "Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:87.0) Gecko/20100101 Firefox/103.0");
+        curl_easy_setopt(curl.get(), CURLOPT_TIMEOUT, 10L);
+        if (head)
+        {
+            curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1L);
+        }
+        else
+        {
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &LinkResolver::discardBody);
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, curl.get());
+        }
+
+        const CURLcode res = _pool.perform(curl.get());
+        // A GET of a page that is not a redirect is cut off at its body
+        if (res != CURLE_OK && !(res == CURLE_WRITE_ERROR && !head))
+        {
+            spdlog::debug("Resolving {} failed: {}", url, curl_easy_strerror(res));
+            return false;
+        }
+
+        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &status);
+        char *redirect = nullptr;
+        curl_easy_getinfo(curl.get(), CURLINFO_REDIRECT_URL, &redirect);
+        location = redirect ? redirect : "";
+        return true;
+    }
+
+    /// @brief Write callback that drops the body, aborting unless it is a redirect.
+    /// NOTE: curl only reports the redirect target of a completed transfer,
+    /// redirect bodies are a few bytes anyway.
+    size_t LinkResolver::discardBody(char *, size_t size, size_t nmemb, void *userdata)
+    {
+        long status = 0;
+        curl_easy_getinfo(static_cast<CURL *>(userdata), CURLINFO_RESPONSE_CODE, &status);
+        return (status >= 300 && status < 400) ? size * nmemb : 0;
+    }
+
+    bool LinkResolver::lookup(const std::string &url, std::string &canonical)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        const auto it = _cache.find(url);
+        if (it == _cache.end())
+        {
+            return false;
+        }
+        if (it->second.expires <= Clock::now())
+        {
+            _cache.erase(it);
+            return false;
+        }
+        canonical = it->second.canonical;
+        return true;
+    }
+
+    void LinkResolver::store(const std::string &url, const std::string &canonical)
+    {
+        const auto now = Clock::now();
+
+        std::lock_guard<std::mutex> lock(_mutex);
+        if (_cache.size() >= _capacity)
+        {
+            for (auto it = _cache.begin(); it != _cache.end();)
+            {
+                it = it->second.expires <= now ? _cache.erase(it) : std::next(it);
+            }
+            // Still full of live links, make room with an arbitrary one
+            if (_cache.size() >= _capacity)
+            {
+                _cache.erase(_cache.begin());
+            }
+        }
+        _cache[url] = {canonical, now + _ttl};
+    }
+
+} // !namespace linkResolver
@@ -0,0 +1,214 @@
+#include "include/metrics.h"
+#include "include/long_poller.h"
+
+namespace longPoller
+{
+    using metrics::Metrics;
+    using Response = botApiClient::BotApiClient::Response;
+
+    /// @brief Create the poller.
+    /// @param ioc[in] io_context the polls run on.
+    /// @param client[in] Client the polls are sent with.
+    /// @param sipeto[in] Bot whose workers process the updates.
+    /// @param limit[in] Most updates per batch, 1 to 100.
+    /// @param timeout[in] How long Telegram holds a poll open.
+    /// @param offsetFile[in] Where the next offset is kept.
+    LongPoller::LongPoller(boost::asio::io_context &ioc,
+                           botApiClient::BotApiClient &client,
+                           sipeto::Sipeto &sipeto,
+                           std::size_t limit,
+                           std::chrono::seconds timeout,
+                           std::string offsetFile)
+        : _strand(boost::asio::make_strand(ioc)),
+          _timer(_strand),
+          _client(client),
+          _sipeto(sipeto),
+          _limit(std::min<std::size_t>(std::max<std::size_t>(limit, 1), 100)),
+          _timeout(timeout),
+          _offsetFile(std::move(offsetFile)),
+          _polls(Metrics::instance().get("poll_requests_total")),
+          _updates(Metrics::instance().get("poll_updates_total")),
+          _errors(Metrics::instance().get("poll_errors_total")),
+          _maxBatch(Metrics::instance().get("poll_batch_size_max")) {}
+
+    /// @brief Resume from the saved offset and start polling.
+    /// @param none.
+    /// @return none.
+    /// NOTE: getUpdates is refused while a webhook is set, so it is removed first.
+    void LongPoller::start()
+    {
+        loadOffset();
+        _sipeto.getLogger()->info("Polling for updates from offset {}.", _offset);
+
+        _client.call("deleteWebhook", std::string(), [this](Response response)
+                     {
+                         if (!response.ok())
+                         {
+                             _sipeto.getLogger()->error("deleteWebhook failed ({}): {}", response.status, response.body);
+                         }
+                         boost::asio::post(_strand, [this]
+                                           { poll(); }); });
+    }
+
+    /// @brief Stop after the poll in flight returns.
+    /// @param none.
+    /// @return none.
+    void LongPoller::stop()
+    {
+        boost::asio::post(_strand, [this]
+                          {
+                              _stopped = true;
+                              _timer.cancel(); });
+    }
+
+    /// @brief Send the next getUpdates.
+    /// @param none.
+    /// @return none.
+    void LongPoller::poll()
+    {
+        if (_stopped)
+        {
+            return;
+        }
+
+        std::string form = "offset=" + std::to_string(_offset) +
+                           "&limit=" + std::to_string(_limit) +
+                           "&timeout=" + std::to_string(_timeout.count()) +
+                           "&allowed_updates=" + std::string(sipeto::Sipeto::_allowedUpdates);
+
+        // Leave Telegram time to answer an idle poll before giving up
+        const auto requestTimeout = std::chrono::duration_cast<std::chrono::milliseconds>(_timeout) + std::chrono::seconds(10);
+
+        _polls.fetch_add(1, std::memory_order_relaxed);
+        _client.call(
+            "getUpdates", std::move(form),
+            [this](Response response)
+            {
+                boost::asio::post(_strand, [this, response = std::move(response)]
+                                  { onBatch(response); });
+            },
+            requestTimeout);
+    }
+
+    /// @brief Poll again after a delay.
+    /// @param delay[in] Time to wait.
+    /// @return none.
+    void LongPoller::pollLater(std::chrono::milliseconds delay)
+    {
+        _timer.expires_after(delay);
+        _timer.async_wait(boost::asio::bind_executor(_strand, [this](boost::system::error_code ec)
+                                                     {
+                                                         if (!ec)
+                                                         {
+                                                             poll();
+                                                         } }));
+    }
+
+    /// @brief Queue a batch for the workers, then poll for the next one.
+    /// @param response[in] The getUpdates response.
+    /// @return none.
+    void LongPoller::onBatch(const Response &response)
+    {
+        if (!response.ok())
+        {
+            _errors.fetch_add(1, std::memory_order_relaxed);
+            if (response.status == 409)
+            {
+                _sipeto.getLogger()->error("getUpdates conflicts with a webhook or another poller: {}", response.body);
+            }
+            else
+            {
+                _sipeto.getLogger()->error("getUpdates failed ({}): {}", response.status,
+                                           response.code != CURLE_OK ? curl_easy_strerror(response.code) : response.body);
+            }
+            pollLater(std::chrono::seconds(1));
+            return;
+        }
+
+        _batch.clear();
+        if (!updateParser::parseUpdateBatch(response.body, _batch))
+        {
+            _errors.fetch_add(1, std::memory_order_relaxed);
+            _sipeto.getLogger()->error("Malformed getUpdates response: {}", response.body);
+            pollLater(std::chrono::seconds(1));
+            return;
+        }
+
+        Metrics::storeMax(_maxBatch, _batch.size());
+
+        const std::int64_t previous = _offset;
+        bool backlogged = false;
+        for (const auto &update : _batch)
+        {
+            if (!_sipeto.wantsUpdate(update.body))
+            {
+                _offset = update.updateId + 1;
+                continue;
+            }
+
+            const auto result = _sipeto.enqueueUpdate(std::string(update.body));
+            if (result == updateQueue::PushResult::Rejected || result == updateQueue::PushResult::Closed)
+            {
+                // Not confirmed, Telegram hands it out again on the next poll
+                backlogged = true;
+                break;
+            }
+            _offset = update.updateId + 1;
+            _updates.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (_offset != previous)
+        {
+            storeOffset();
+        }
+
+        // The workers process this batch while the next poll is in flight
+        if (backlogged)
+        {
+            pollLater(std::chrono::milliseconds(100));
+        }
+        else
+        {
+            poll();
+        }
+    }
+
+    /// @brief Read the saved offset, if any.
+    /// @param none.
+    /// @return none.
+    void LongPoller::loadOffset()
+    {
+        std::ifstream file(_offsetFile);
+        if (file >> _offset)
+        {
+            return;
+        }
+        _offset = 0;
+    }
+
+    /// @brief Save the next offset, replacing the file atomically.
+    /// @param none.
+    /// @return none.
+    void LongPoller::storeOffset()
+    {
+        const std::string temporary = _offsetFile + ".tmp";
+        {
+            std::ofstream file(temporary, std::ios::trunc);
+            file << _offset << '\n';
+            file.flush();
+            if (!file)
+            {
+                _sipeto.getLogger()->error("Failed to write offset file: {}", temporary);
+                return;
+            }
+        }
+
+        std::error_code ec;
+        std::filesystem::rename(temporary, _offsetFile, ec);
+        if (ec)
+        {
+            _sipeto.getLogger()->error("Failed to replace offset file {}: {}", _offsetFile, ec.message());
+        }
+    }
+
+} // !namespace longPoller
@@ -2,6 +2,7 @@
 #include "include/tiktok.h"
 #include "include/twitter.h"
 #include "include/instagram.h"
+#include "include/long_poller.h"
 
 using namespace std;
 using namespace sipeto;
@@ -25,15 +26,67 @@ int main(int argc, char **argv)
     tiktok.displayMap(tiktok.getTheMap());
     exit(0);
 
-    boost::asio::io_context ioc{1};
+    /// NOTE: "threads" defaults to one I/O thread per core.
+    const auto threads = static_cast<std::size_t>(std::max(1, std::atoi(
+        sipeto.getFromConfigMapOr("threads", std::to_string(std::thread::hardware_concurrency())).c_str())));
+    const bool reusePort = sipeto.getFromConfigMapOr("reusePort", "false") == "true";
+
+    boost::asio::io_context ioc{static_cast<int>(threads)};
     auto address = ip::make_address(sipeto.getFromConfigMap("address"));
     auto port = static_cast<unsigned short>(std::atoi(sipeto.getFromConfigMap("port").c_str()));
     tcp::endpoint endpoint{address, port};
 
-    SimpleHttpServer server(ioc, endpoint, sipeto);
+    // Updates are acknowledged by the server and processed by these workers
+    sipeto.startWorkers(static_cast<std::size_t>(std::max(1, std::atoi(
+        sipeto.getFromConfigMapOr("workers", std::to_string(std::thread::hardware_concurrency())).c_str()))));
+
+    // Outbound Bot API calls run on the server's io_context
+    botApiClient::BotApiClient botClient(ioc,
+                                         sipeto.getFromConfigMap("endpoint") + sipeto.getFromConfigMap("token") + "/",
+                                         std::chrono::milliseconds(std::atoi(sipeto.getFromConfigMapOr("apiTimeout", "10000").c_str())));
+    sipeto.setBotClient(&botClient);
+
+    /// NOTE: Telegram allows about 1 message/s per chat and 30 messages/s overall.
+    messageScheduler::MessageScheduler scheduler(ioc, botClient,
+                                                 std::atof(sipeto.getFromConfigMapOr("chatRate", "1").c_str()),
+                                                 std::atof(sipeto.getFromConfigMapOr("globalRate", "30").c_str()),
+                                                 sipeto.getFromConfigMapOr("mergeMessages", "true") == "true");
+    sipeto.setMessageScheduler(&scheduler);
+
+    /// NOTE: "ingestion" is "webhook" (default) or "polling" for getUpdates.
+    if (sipeto.getFromConfigMapOr("ingestion", "webhook") == "polling")
+    {
+        longPoller::LongPoller poller(ioc, botClient, sipeto,
+                                      static_cast<std::size_t>(std::atoi(sipeto.getFromConfigMapOr("pollLimit", "100").c_str())),
+                                      std::chrono::seconds(std::atoi(sipeto.getFromConfigMapOr("pollTimeout", "30").c_str())),
+                                      sipeto.getFromConfigMapOr("offsetFile", "sipeto.offset"));
+        poller.start();
+
+        // No server runs the io_context in this mode, run it here
+        auto work = boost::asio::make_work_guard(ioc);
+        std::vector<std::thread> ioThreads;
+        for (std::size_t i = 0; i < threads; ++i)
+        {
+            ioThreads.emplace_back([&ioc]
+                                   { ioc.run(); });
+        }
+        for (auto &thread : ioThreads)
+        {
+            thread.join();
+        }
+    }
+    else
+    {
+        SimpleHttpServer server(ioc, endpoint, sipeto, threads, reusePort);
+
+        // Run the http server until it is stopped
+        server.run();
+    }
 
-    // Start the http server
-    server.start();
+    // The workers may still send replies, stop them before the client goes away
+    sipeto.stopWorkers();
+    sipeto.setMessageScheduler(nullptr);
+    sipeto.setBotClient(nullptr);
 
     return 0;
 }
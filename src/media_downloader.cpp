@@ -3,6 +3,8 @@
 #include <boost/asio.hpp>
 
 #include "include/media_downloader.h"
+#include "include/curl_pool.h"
+#include "include/string_switch.h"
 
 namespace asio = boost::asio;
 namespace beast = boost::beast;
@@ -11,6 +13,24 @@ namespace mediaDownloader
 {
     std::shared_ptr<spdlog::logger> MediaDownloader::_logger = spdlog::stdout_color_mt("MediaDownloader");
 
+    /// @brief Map a platform's media type name to a MediaType.
+    /// @param name[in] e.g. "video", "photo" or "IMAGE".
+    /// @return The matching type, Unknown if the name is not known.
+    MediaType mediaTypeOf(std::string_view name)
+    {
+        static constexpr auto types = stringSwitch::makeStringMap<MediaType>({
+            {"video", MediaType::Video},
+            {"VIDEO", MediaType::Video},
+            {"photo", MediaType::Image},
+            {"image", MediaType::Image},
+            {"IMAGE", MediaType::Image},
+            {"animated_gif", MediaType::AnimatedGif},
+            {"audio", MediaType::Audio},
+            {"music", MediaType::Audio},
+        });
+        return types.valueOr(name, MediaType::Unknown);
+    }
+
     namespace asio = boost::asio;
     using tcp = boost::asio::ip::tcp;
 
@@ -119,11 +139,6 @@ namespace mediaDownloader
         }
         return errorString;
     }
-    size_t MediaDownloader::writeCallback(char *ptr, size_t size, size_t nmemb, std::string *data)
-    {
-        data->append(ptr, size * nmemb);
-        return size * nmemb;
-    }
 
     /// @brief Load each config map from the config file.
     /// @param root[in] The root of the config file.
@@ -162,45 +177,119 @@ namespace mediaDownloader
         }
     }
 
-    std::string MediaDownloader::performHttpGetRequest(const std::string &url, const std::string &bearerToken)
+    /// @brief The network context requests go through.
+    /// @param none.
+    /// @return The context the downloader was created with.
+    /// NOTE: throws std::logic_error if the downloader was created without one.
+    networkContext::NetworkContext &MediaDownloader::network() const
     {
-        // Initialize the libcurl library
-        curl_global_init(CURL_GLOBAL_DEFAULT);
+        if (!_network)
+        {
+            throw std::logic_error("MediaDownloader: created without a network context");
+        }
+        return *_network;
+    }
 
-        // Create a new curl session
-        CURL *curl = curl_easy_init();
+    /// @brief GET a document with an optional bearer token.
+    /// @param url[in] The URL to request.
+    /// @param bearerToken[in] Sent as "Authorization: Bearer ...", blank for none.
+    /// @return The response body, empty if the request failed.
+    std::string MediaDownloader::performHttpGetRequest(const std::string &url, const std::string &bearerToken)
+    {
+        curlPool::CurlPool &pool = network().pool();
+        auto curl = pool.acquire();
         if (!curl)
         {
-            throw std::runtime_error("Failed to initialize curl");
+            _logger->error("Failed to initialize curl");
+            return {};
         }
 
         _logger->debug("performing HTTP GET request to URL: {}", url);
 
         std::string response;
-
-        // Set the curl session options
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + bearerToken).c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-        // Perform the HTTP GET request
-        CURLcode res = curl_easy_perform(curl);
-        if (res != CURLE_OK)
+        curl_slist *headers = nullptr;
+        if (bearerToken.find_first_not_of(' ') != std::string::npos)
         {
-            throw std::runtime_error("Failed to perform curl request: " + std::string(curl_easy_strerror(res)));
+            headers = curl_slist_append(headers, ("Authorization: Bearer " + bearerToken).c_str());
         }
+        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, headers);
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &curlPool::CurlPool::appendCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
 
-        // Cleanup and return the HTTP response
-        curl_easy_cleanup(curl);
+        const CURLcode res = pool.perform(curl.get());
         curl_slist_free_all(headers);
-        curl_global_cleanup();
+        if (res != CURLE_OK)
+        {
+            _logger->error("Failed to perform curl request: {}", curl_easy_strerror(res));
+            return {};
+        }
 
         _logger->debug("Finished performing HTTP GET request to URL: {}", url);
-
         return response;
     }
 
-} // !namespace mediaDownloader
\ No newline at end of file
+    /// @brief Download a media file, in parallel ranges when it is large enough.
+    /// @param url[in] The file's address.
+    /// @param path[in] Where to store it.
+    /// @return false if the download failed, nothing is left at path then.
+    bool MediaDownloader::downloadToFile(const std::string &url, const std::string &path)
+    {
+        rangeDownloader::RangeDownloader downloader(network().pool(), network().downloadLimits());
+        return downloader.download(url, path);
+    }
+
+    /// @brief GET a JSON document, keeping only the paths the extractor asks for.
+    /// @param url[in] The API endpoint.
+    /// @param platform[in] Whose prebuilt headers are sent.
+    /// @param extractor[in,out] Fed the response as it arrives.
+    /// @return false if the request failed or the response is not JSON.
+    /// NOTE: the transfer stops as soon as the extractor has every
+    /// required path, the rest of the response is never downloaded.
+    bool MediaDownloader::performJsonRequest(const std::string &url,
+                                             urlRouter::Platform platform,
+                                             jsonPath::Extractor &extractor)
+    {
+        curlPool::CurlPool &pool = network().pool();
+
+        auto curl = pool.acquire();
+        if (!curl)
+        {
+            _logger->error("Failed to initialize curl");
+            return false;
+        }
+
+        _logger->debug("performing JSON request to URL: {}", url);
+
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, network().headers(platform));
+        curl_easy_setopt(curl.get(), CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &jsonPath::Extractor::writeCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &extractor);
+
+        const CURLcode res = pool.perform(curl.get());
+
+        if (extractor.failed())
+        {
+            _logger->error("Malformed JSON response from {}", url);
+            return false;
+        }
+        // A write error is the extractor stopping the transfer early
+        if (res == CURLE_WRITE_ERROR && extractor.complete())
+        {
+            return true;
+        }
+        if (res != CURLE_OK)
+        {
+            _logger->error("Failed to perform curl request: {}", curl_easy_strerror(res));
+            return false;
+        }
+        if (!extractor.finish())
+        {
+            _logger->error("Truncated JSON response from {}", url);
+            return false;
+        }
+        return true;
+    }
+
+} // !namespace mediaDownloader
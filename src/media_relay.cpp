@@ -0,0 +1,261 @@
+#include "include/metrics.h"
+#include "include/media_relay.h"
+#include "include/range_downloader.h"
+
+namespace mediaRelay
+{
+    using metrics::Metrics;
+
+    RingBuffer::RingBuffer(std::size_t capacity) : _data(std::max<std::size_t>(capacity, CURL_MAX_WRITE_SIZE)) {}
+
+    /// @brief Append bytes, as many as fit.
+    /// @param data[in] The bytes.
+    /// @param size[in] How many.
+    /// @return How many were taken.
+    std::size_t RingBuffer::write(const char *data, std::size_t size)
+    {
+        size = std::min(size, space());
+        const std::size_t tail = (_head + _size) % _data.size();
+        const std::size_t first = std::min(size, _data.size() - tail);
+        std::memcpy(_data.data() + tail, data, first);
+        std::memcpy(_data.data(), data + first, size - first);
+        _size += size;
+        return size;
+    }
+
+    /// @brief Take bytes from the front.
+    /// @param data[out] Where they go.
+    /// @param size[in] Room at data.
+    /// @return How many were taken.
+    std::size_t RingBuffer::read(char *data, std::size_t size)
+    {
+        size = std::min(size, _size);
+        const std::size_t first = std::min(size, _data.size() - _head);
+        std::memcpy(data, _data.data() + _head, first);
+        std::memcpy(data + first, _data.data(), size - first);
+        _head = (_head + size) % _data.size();
+        _size -= size;
+        return size;
+    }
+
+    /// @brief Create a relay.
+    /// @param source[in] Pool the downloads lease their handles from.
+    /// @param telegram[in] Pool with the warm Bot API connections.
+    /// @param apiBase[in] Bot API base, e.g. "https://api.telegram.org/bot<token>/".
+    /// @param limits[in] Buffer and upload size limits.
+    MediaRelay::MediaRelay(curlPool::CurlPool &source, curlPool::CurlPool &telegram,
+                           std::string apiBase, Limits limits)
+        : _source(source),
+          _telegram(telegram),
+          _apiBase(std::move(apiBase)),
+          _limits(limits),
+          _sent(Metrics::instance().get("relay_sent_total")),
+          _skipped(Metrics::instance().get("relay_skipped_total")),
+          _failed(Metrics::instance().get("relay_failed_total")),
+          _bytes(Metrics::instance().get("relay_bytes_total")) {}
+
+    /// @brief Send a media file to a chat while it downloads.
+    /// @param url[in] The file's address.
+    /// @param request[in] Chat and kind it is sent as, with its file name and type.
+    /// @return Skipped if the file cannot be relayed, download it instead then.
+    MediaRelay::Result MediaRelay::relay(const std::string &url, const mediaUpload::Request &request)
+    {
+        rangeDownloader::RangeDownloader::Probe probed;
+        if (!rangeDownloader::RangeDownloader(_source).probe(url, probed) ||
+            probed.size <= 0 || probed.size > _limits.maxSize)
+        {
+            _skipped.fetch_add(1, std::memory_order_relaxed);
+            return Result::Skipped;
+        }
+
+        auto source = _source.acquire();
+        auto sender = _telegram.acquire();
+        if (!source || !sender)
+        {
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            return Result::Failed;
+        }
+
+        State state(_limits.bufferSize);
+        state.size = probed.size;
+
+        curl_easy_setopt(source.get(), CURLOPT_URL, probed.url.c_str());
+        curl_easy_setopt(source.get(), CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(source.get(), CURLOPT_MAXREDIRS, 5L);
+        curl_easy_setopt(source.get(), CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(source.get(), CURLOPT_WRITEFUNCTION, &MediaRelay::writeSource);
+        curl_easy_setopt(source.get(), CURLOPT_WRITEDATA, &state);
+
+        // The file part declares the probed size, its bytes come from the buffer
+        curl_mime *form = mediaUpload::MediaUploader::buildForm(sender.get(), request, probed.size,
+                                                                &MediaRelay::readUpload, nullptr, &state);
+        if (!form)
+        {
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            return Result::Failed;
+        }
+
+        const std::string apiUrl = _apiBase + std::string(mediaUpload::methodOf(request.kind).name);
+        std::string response;
+        curl_easy_setopt(sender.get(), CURLOPT_URL, apiUrl.c_str());
+        curl_easy_setopt(sender.get(), CURLOPT_MIMEPOST, form);
+        curl_easy_setopt(sender.get(), CURLOPT_WRITEFUNCTION, &curlPool::CurlPool::appendCallback);
+        curl_easy_setopt(sender.get(), CURLOPT_WRITEDATA, &response);
+
+        long status = 0;
+        const bool ok = transfer(source.get(), sender.get(), state, status);
+        // The handle still points at the form until the lease resets it
+        curl_easy_setopt(sender.get(), CURLOPT_MIMEPOST, nullptr);
+        curl_mime_free(form);
+
+        _bytes.fetch_add(static_cast<std::uint64_t>(state.sent), std::memory_order_relaxed);
+        if (!ok || status != 200)
+        {
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            spdlog::error("Failed to relay {} with {} ({}): {}", url, mediaUpload::methodOf(request.kind).name,
+                          status, response);
+            return Result::Failed;
+        }
+        _sent.fetch_add(1, std::memory_order_relaxed);
+        return Result::Sent;
+    }
+
+    /// @brief Run both transfers until the upload ends.
+    /// @param source[in] The download.
+    /// @param upload[in] The upload.
+    /// @param state[in,out] The shared state of their callbacks.
+    /// @param status[out] HTTP status of the upload.
+    /// @return false if the upload did not complete.
+    /// NOTE: curl_easy_pause is only called between curl_multi_perform
+    /// calls, never from a callback of the other transfer.
+    bool MediaRelay::transfer(CURL *source, CURL *upload, State &state, long &status)
+    {
+        CURLM *multi = curl_multi_init();
+        if (!multi)
+        {
+            return false;
+        }
+        curl_multi_add_handle(multi, source);
+        curl_multi_add_handle(multi, upload);
+
+        bool sourceRunning = true;
+        bool uploadRunning = true;
+        CURLcode uploadResult = CURLE_OK;
+        while (uploadRunning)
+        {
+            int running = 0;
+            if (curl_multi_perform(multi, &running) != CURLM_OK)
+            {
+                uploadResult = CURLE_RECV_ERROR;
+                break;
+            }
+
+            int queued = 0;
+            while (CURLMsg *message = curl_multi_info_read(multi, &queued))
+            {
+                if (message->msg != CURLMSG_DONE)
+                {
+                    continue;
+                }
+                curl_multi_remove_handle(multi, message->easy_handle);
+                if (message->easy_handle == source)
+                {
+                    sourceRunning = false;
+                    state.sourceDone = true;
+                    state.sourceFailed = message->data.result != CURLE_OK || state.received != state.size;
+                    if (state.sourceFailed)
+                    {
+                        spdlog::error("Relay download failed after {} of {} bytes: {}", state.received,
+                                      state.size, curl_easy_strerror(message->data.result));
+                    }
+                }
+                else
+                {
+                    uploadRunning = false;
+                    uploadResult = message->data.result;
+                }
+            }
+
+            // Each side resumes once the other made room or data for it
+            if (sourceRunning && state.sourcePaused && state.buffer.space() >= state.pending)
+            {
+                state.sourcePaused = false;
+                curl_easy_pause(source, CURLPAUSE_CONT);
+            }
+            if (uploadRunning && state.uploadPaused && (state.buffer.size() > 0 || state.sourceDone))
+            {
+                state.uploadPaused = false;
+                curl_easy_pause(upload, CURLPAUSE_CONT);
+            }
+
+            if (uploadRunning)
+            {
+                curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+            }
+        }
+
+        curl_multi_remove_handle(multi, source);
+        curl_multi_remove_handle(multi, upload);
+        curl_multi_cleanup(multi);
+
+        curl_easy_getinfo(upload, CURLINFO_RESPONSE_CODE, &status);
+        if (uploadResult != CURLE_OK)
+        {
+            spdlog::error("Relay upload failed after {} bytes: {}", state.sent, curl_easy_strerror(uploadResult));
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief curl write callback filling the buffer from the download.
+    /// @return CURL_WRITEFUNC_PAUSE while the chunk does not fit, 0 to abort
+    /// a download longer than probed or a chunk larger than the buffer.
+    size_t MediaRelay::writeSource(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        auto *state = static_cast<State *>(userdata);
+        const size_t bytes = size * nmemb;
+
+        if (state->received + static_cast<curl_off_t>(bytes) > state->size || bytes > state->buffer.capacity())
+        {
+            return 0;
+        }
+        if (bytes > state->buffer.space())
+        {
+            // curl hands the same chunk over again once unpaused
+            state->pending = bytes;
+            state->sourcePaused = true;
+            return CURL_WRITEFUNC_PAUSE;
+        }
+
+        state->buffer.write(ptr, bytes);
+        state->received += static_cast<curl_off_t>(bytes);
+        return bytes;
+    }
+
+    /// @brief curl mime read callback draining the buffer into the upload.
+    /// @return CURL_READFUNC_PAUSE while the buffer is empty,
+    /// CURL_READFUNC_ABORT once the download failed.
+    size_t MediaRelay::readUpload(char *buffer, size_t size, size_t nitems, void *userdata)
+    {
+        auto *state = static_cast<State *>(userdata);
+
+        if (state->buffer.size() == 0)
+        {
+            if (state->sourceFailed)
+            {
+                return CURL_READFUNC_ABORT;
+            }
+            if (state->sourceDone)
+            {
+                return 0;
+            }
+            state->uploadPaused = true;
+            return CURL_READFUNC_PAUSE;
+        }
+
+        const size_t taken = state->buffer.read(buffer, size * nitems);
+        state->sent += static_cast<curl_off_t>(taken);
+        return taken;
+    }
+
+} // !namespace mediaRelay
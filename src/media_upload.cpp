@@ -0,0 +1,258 @@
+#include "include/metrics.h"
+#include "include/media_upload.h"
+#include "include/string_switch.h"
+
+#include <fcntl.h>
+#include <sys/stat.h>
+
+namespace mediaUpload
+{
+    using metrics::Metrics;
+
+    /// @brief The Bot API method sending a kind of media.
+    /// @param kind[in] The kind of media.
+    /// @return Method name and form field, e.g. {"sendVideo", "video"}.
+    Method methodOf(Kind kind)
+    {
+        switch (kind)
+        {
+        case Kind::Video:
+            return {"sendVideo", "video"};
+        case Kind::Photo:
+            return {"sendPhoto", "photo"};
+        case Kind::Audio:
+            return {"sendAudio", "audio"};
+        case Kind::Document:
+        default:
+            return {"sendDocument", "document"};
+        }
+    }
+
+    /// @brief Guess the content type of a file from its extension.
+    /// @param filename[in] The file name.
+    /// @return The MIME type, "application/octet-stream" if unknown.
+    std::string_view mimeTypeOf(std::string_view filename)
+    {
+        static constexpr auto types = stringSwitch::makeStringMap<std::string_view>({
+            {"mp4", "video/mp4"},
+            {"mov", "video/quicktime"},
+            {"webm", "video/webm"},
+            {"jpg", "image/jpeg"},
+            {"jpeg", "image/jpeg"},
+            {"png", "image/png"},
+            {"webp", "image/webp"},
+            {"gif", "image/gif"},
+            {"mp3", "audio/mpeg"},
+            {"m4a", "audio/mp4"},
+            {"ogg", "audio/ogg"},
+        });
+
+        const auto dot = filename.rfind('.');
+        std::string extension(dot == std::string_view::npos ? std::string_view() : filename.substr(dot + 1));
+        boost::algorithm::to_lower(extension);
+        return types.valueOr(extension, "application/octet-stream");
+    }
+
+    /// @brief Create an uploader.
+    /// @param telegram[in] Pool with the warm Bot API connections.
+    /// @param apiBase[in] Bot API base, e.g. "https://api.telegram.org/bot<token>/".
+    MediaUploader::MediaUploader(curlPool::CurlPool &telegram, std::string apiBase)
+        : _telegram(telegram),
+          _apiBase(std::move(apiBase)),
+          _sent(Metrics::instance().get("upload_sent_total")),
+          _failed(Metrics::instance().get("upload_failed_total")),
+          _bytes(Metrics::instance().get("upload_bytes_total")) {}
+
+    /// @brief Send a file from disk to a chat.
+    /// @param request[in] Chat, kind and caption. The filename and the
+    /// MIME type are taken from the path when blank.
+    /// @param path[in] The file.
+    /// @param progress[in] Called about once a second and when done, the
+    /// progress is logged when none is given.
+    /// @return false if the file could not be read or Telegram refused it.
+    bool MediaUploader::send(Request request, const std::string &path, ProgressHandler progress)
+    {
+        const int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+        struct stat info{};
+        if (fd < 0 || ::fstat(fd, &info) != 0)
+        {
+            spdlog::error("Could not open {}: {}", path, std::strerror(errno));
+            if (fd >= 0)
+            {
+                ::close(fd);
+            }
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+        // Read once from start to end, the kernel can read ahead and drop behind
+        ::posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+        if (request.filename.empty())
+        {
+            request.filename = std::filesystem::path(path).filename().string();
+        }
+        if (request.mimeType.empty())
+        {
+            request.mimeType = mimeTypeOf(request.filename);
+        }
+        if (!progress)
+        {
+            progress = [path](const Progress &p)
+            {
+                spdlog::debug("Uploading {}: {} of {} bytes, {:.1f} KiB/s", path, p.sent, p.total,
+                              p.bytesPerSecond / 1024);
+            };
+        }
+
+        auto curl = _telegram.acquire();
+        if (!curl)
+        {
+            ::close(fd);
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            return false;
+        }
+
+        Source source;
+        source.fd = fd;
+        source.progress = std::move(progress);
+        source.started = source.reported = std::chrono::steady_clock::now();
+        source.last.total = static_cast<curl_off_t>(info.st_size);
+
+        curl_mime *form = buildForm(curl.get(), request, source.last.total,
+                                    &MediaUploader::readFile, &MediaUploader::seekFile, &source);
+        const std::string url = _apiBase + std::string(methodOf(request.kind).name);
+        std::string response;
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_MIMEPOST, form);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &curlPool::CurlPool::appendCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
+        curl_easy_setopt(curl.get(), CURLOPT_NOPROGRESS, 0L);
+        curl_easy_setopt(curl.get(), CURLOPT_XFERINFOFUNCTION, &MediaUploader::reportProgress);
+        curl_easy_setopt(curl.get(), CURLOPT_XFERINFODATA, &source);
+
+        const CURLcode res = form ? _telegram.perform(curl.get()) : CURLE_OUT_OF_MEMORY;
+        long status = 0;
+        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &status);
+        // The handle still points at the form until the lease resets it
+        curl_easy_setopt(curl.get(), CURLOPT_MIMEPOST, nullptr);
+        curl_mime_free(form);
+        ::close(fd);
+
+        if (res != CURLE_OK || status != 200)
+        {
+            _failed.fetch_add(1, std::memory_order_relaxed);
+            spdlog::error("Failed to send {} with {} ({}, {}): {}", path, methodOf(request.kind).name,
+                          curl_easy_strerror(res), status, response);
+            return false;
+        }
+
+        const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - source.started).count();
+        source.last.sent = source.last.total;
+        source.last.bytesPerSecond = seconds > 0 ? static_cast<double>(source.last.total) / seconds : 0;
+        source.progress(source.last);
+
+        _sent.fetch_add(1, std::memory_order_relaxed);
+        _bytes.fetch_add(static_cast<std::uint64_t>(source.last.total), std::memory_order_relaxed);
+        spdlog::info("Sent {} ({} bytes) to chat {} in {:.1f}s, {:.1f} MiB/s", path, source.last.total,
+                     request.chatId, seconds, source.last.bytesPerSecond / (1 << 20));
+        return true;
+    }
+
+    /// @brief Build the multipart body of a send method.
+    /// @param handle[in] The handle that sends it.
+    /// @param request[in] Chat, kind, file name, type and caption.
+    /// @param size[in] Length of the file part.
+    /// @param read[in] Fills the file part as curl sends it.
+    /// @param seek[in] Rewinds the file part, nullptr if it cannot be.
+    /// @param arg[in] Passed to read and seek.
+    /// @return The form, owned by the caller, nullptr if out of memory.
+    curl_mime *MediaUploader::buildForm(CURL *handle, const Request &request, curl_off_t size,
+                                        curl_read_callback read, curl_seek_callback seek, void *arg)
+    {
+        curl_mime *form = curl_mime_init(handle);
+        if (!form)
+        {
+            return nullptr;
+        }
+
+        const auto addField = [form](const char *name, const std::string &value)
+        {
+            curl_mimepart *part = curl_mime_addpart(form);
+            curl_mime_name(part, name);
+            curl_mime_data(part, value.c_str(), value.size());
+        };
+
+        addField("chat_id", request.chatId);
+        if (!request.caption.empty())
+        {
+            addField("caption", request.caption);
+        }
+        if (request.kind == Kind::Video)
+        {
+            // Lets the video play before it is fully downloaded
+            addField("supports_streaming", "true");
+        }
+
+        const Method method = methodOf(request.kind);
+        curl_mimepart *part = curl_mime_addpart(form);
+        curl_mime_name(part, std::string(method.field).c_str());
+        curl_mime_filename(part, request.filename.c_str());
+        curl_mime_type(part, request.mimeType.c_str());
+        curl_mime_data_cb(part, size, read, seek, nullptr, arg);
+        return form;
+    }
+
+    /// @brief curl mime read callback reading the file at the send position.
+    /// @return The bytes read, CURL_READFUNC_ABORT if reading failed.
+    size_t MediaUploader::readFile(char *buffer, size_t size, size_t nitems, void *arg)
+    {
+        auto *source = static_cast<Source *>(arg);
+        for (;;)
+        {
+            const ssize_t count = ::pread(source->fd, buffer, size * nitems, static_cast<off_t>(source->offset));
+            if (count >= 0)
+            {
+                source->offset += count;
+                return static_cast<size_t>(count);
+            }
+            if (errno != EINTR)
+            {
+                spdlog::error("Failed to read an upload: {}", std::strerror(errno));
+                return CURL_READFUNC_ABORT;
+            }
+        }
+    }
+
+    /// @brief curl mime seek callback, used when a request is sent again.
+    /// @return CURL_SEEKFUNC_OK, CURL_SEEKFUNC_CANTSEEK for relative seeks.
+    int MediaUploader::seekFile(void *arg, curl_off_t offset, int origin)
+    {
+        if (origin != SEEK_SET || offset < 0)
+        {
+            return CURL_SEEKFUNC_CANTSEEK;
+        }
+        static_cast<Source *>(arg)->offset = offset;
+        return CURL_SEEKFUNC_OK;
+    }
+
+    /// @brief curl progress callback, reporting at most once per REPORT_INTERVAL.
+    /// @return 0, the upload is never cancelled from here.
+    int MediaUploader::reportProgress(void *clientp, curl_off_t, curl_off_t, curl_off_t, curl_off_t)
+    {
+        auto *source = static_cast<Source *>(clientp);
+        const auto now = std::chrono::steady_clock::now();
+        if (now - source->reported < REPORT_INTERVAL)
+        {
+            return 0;
+        }
+        source->reported = now;
+
+        const double seconds = std::chrono::duration<double>(now - source->started).count();
+        // Bytes handed to curl, the multipart framing is not counted
+        source->last.sent = source->offset;
+        source->last.bytesPerSecond = seconds > 0 ? static_cast<double>(source->offset) / seconds : 0;
+        source->progress(source->last);
+        return 0;
+    }
+
+} // !namespace mediaUpload
@@ -0,0 +1,289 @@
+#include "include/metrics.h"
+#include "include/message_scheduler.h"
+
+namespace messageScheduler
+{
+    using metrics::Metrics;
+    using Clock = std::chrono::steady_clock;
+
+    /// @brief Bucket holding at most burst tokens, refilled at rate per second.
+    TokenBucket::TokenBucket(double rate, double burst)
+        : _rate(std::max(rate, 0.001)), _burst(std::max(burst, 1.0)), _tokens(_burst), _last(Clock::now()) {}
+
+    void TokenBucket::refill(Clock::time_point now)
+    {
+        const std::chrono::duration<double> elapsed = now - _last;
+        if (elapsed.count() > 0)
+        {
+            _tokens = std::min(_burst, _tokens + elapsed.count() * _rate);
+            _last = now;
+        }
+    }
+
+    /// @brief Take a token if one is available.
+    /// @param now[in] Current time.
+    /// @return true if a token was taken.
+    bool TokenBucket::take(Clock::time_point now)
+    {
+        refill(now);
+        if (_tokens < 1.0)
+        {
+            return false;
+        }
+        _tokens -= 1.0;
+        return true;
+    }
+
+    /// @brief Whether the bucket has refilled completely.
+    bool TokenBucket::full(Clock::time_point now)
+    {
+        refill(now);
+        return _tokens >= _burst;
+    }
+
+    /// @brief Time until the next token is available.
+    /// @param now[in] Current time.
+    /// @return Zero if a token is available now.
+    Clock::duration TokenBucket::wait(Clock::time_point now)
+    {
+        refill(now);
+        if (_tokens >= 1.0)
+        {
+            return Clock::duration::zero();
+        }
+        return std::chrono::duration_cast<Clock::duration>(
+            std::chrono::duration<double>((1.0 - _tokens) / _rate));
+    }
+
+    /// @brief Create the scheduler.
+    /// @param ioc[in] io_context running the server's I/O threads.
+    /// @param client[in] Client the messages are sent with.
+    /// @param chatRate[in] Messages per second to one chat.
+    /// @param globalRate[in] Messages per second overall.
+    /// @param merge[in] Merge text queued for the same chat.
+    MessageScheduler::MessageScheduler(boost::asio::io_context &ioc,
+                                       botApiClient::BotApiClient &client,
+                                       double chatRate,
+                                       double globalRate,
+                                       bool merge)
+        : _strand(boost::asio::make_strand(ioc)),
+          _timer(_strand),
+          _client(client),
+          _chatRate(chatRate),
+          _merge(merge),
+          _global(globalRate, globalRate),
+          _queued(Metrics::instance().get("scheduler_queued")),
+          _sent(Metrics::instance().get("scheduler_sent_total")),
+          _merged(Metrics::instance().get("scheduler_merged_total")),
+          _throttled(Metrics::instance().get("scheduler_throttled_total")) {}
+
+    /// @brief Queue a text message, safe to call from any thread.
+    /// @param chatId[in] Target chat.
+    /// @param text[in] Message text.
+    /// @param priority[in] Interactive replies go before bulk sends.
+    /// @return none.
+    void MessageScheduler::send(std::string chatId, std::string text, Priority priority)
+    {
+        boost::asio::post(_strand, [this, chatId = std::move(chatId), text = std::move(text), priority]() mutable
+                          {
+                              enqueue(std::move(chatId), std::move(text), priority);
+                              pump(); });
+    }
+
+    /// @brief Add a message to its chat queue, merging it when possible.
+    void MessageScheduler::enqueue(std::string chatId, std::string text, Priority priority)
+    {
+        auto it = _chats.find(chatId);
+        if (it == _chats.end())
+        {
+            it = _chats.emplace(chatId, Chat(_chatRate)).first;
+        }
+        Chat &chat = it->second;
+
+        if (_merge && !chat.queue.empty())
+        {
+            Pending &last = chat.queue.back();
+            if (last.priority == priority && last.text.size() + 1 + text.size() <= MAX_TEXT_LENGTH)
+            {
+                last.text += '\n';
+                last.text += text;
+                _merged.fetch_add(1, std::memory_order_relaxed);
+                return;
+            }
+        }
+
+        chat.queue.push_back({std::move(text), priority});
+        _queued.fetch_add(1, std::memory_order_relaxed);
+        markReady(chatId, chat);
+    }
+
+    /// @brief List a chat as having a message to send.
+    void MessageScheduler::markReady(const std::string &chatId, Chat &chat)
+    {
+        if (chat.ready || chat.inFlight || chat.queue.empty())
+        {
+            return;
+        }
+        chat.ready = true;
+        (chat.queue.front().priority == Priority::Interactive ? _interactive : _bulk).push_back(chatId);
+    }
+
+    /// @brief Send every message the buckets allow, then sleep until the next one.
+    /// @param none.
+    /// @return none.
+    void MessageScheduler::pump()
+    {
+        const auto now = Clock::now();
+        auto wake = Clock::time_point::max();
+
+        for (auto *ready : {&_interactive, &_bulk})
+        {
+            // Visit each chat at most once per pump
+            for (std::size_t n = ready->size(); n > 0 && !ready->empty(); --n)
+            {
+                std::string chatId = std::move(ready->front());
+                ready->pop_front();
+                Chat &chat = _chats.at(chatId);
+
+                if (chat.blockedUntil > now)
+                {
+                    wake = std::min(wake, chat.blockedUntil);
+                    ready->push_back(std::move(chatId));
+                    continue;
+                }
+
+                const auto chatWait = chat.bucket.wait(now);
+                if (chatWait > Clock::duration::zero())
+                {
+                    wake = std::min(wake, now + chatWait);
+                    ready->push_back(std::move(chatId));
+                    continue;
+                }
+
+                if (!_global.take(now))
+                {
+                    // Out of global budget, this chat keeps its turn
+                    wake = std::min(wake, now + _global.wait(now));
+                    ready->push_front(std::move(chatId));
+                    break;
+                }
+
+                chat.bucket.take(now);
+                chat.ready = false;
+                chat.inFlight = true;
+                Pending message = std::move(chat.queue.front());
+                chat.queue.pop_front();
+                dispatch(chatId, std::move(message));
+            }
+        }
+
+        if (wake != Clock::time_point::max())
+        {
+            _timer.expires_at(wake);
+            _timer.async_wait(boost::asio::bind_executor(_strand, [this](boost::system::error_code ec)
+                                                         {
+                                                             if (!ec)
+                                                             {
+                                                                 pump();
+                                                             } }));
+        }
+    }
+
+    /// @brief Call sendMessage for one queued message.
+    void MessageScheduler::dispatch(const std::string &chatId, Pending message)
+    {
+        _queued.fetch_sub(1, std::memory_order_relaxed);
+
+        std::string form = "chat_id=" + encodeForm(chatId) + "&text=" + encodeForm(message.text);
+        _client.call("sendMessage", std::move(form),
+                     [this, chatId, message = std::move(message)](botApiClient::BotApiClient::Response response) mutable
+                     {
+                         boost::asio::post(_strand, [this, chatId, message = std::move(message), response = std::move(response)]() mutable
+                                           { onSent(chatId, std::move(message), response); });
+                     });
+    }
+
+    /// @brief Handle the sendMessage result, holding the chat back on a 429.
+    void MessageScheduler::onSent(const std::string &chatId, Pending message,
+                                  const botApiClient::BotApiClient::Response &response)
+    {
+        Chat &chat = _chats.at(chatId);
+        chat.inFlight = false;
+
+        const auto now = Clock::now();
+        if (response.status == 429)
+        {
+            const long seconds = retryAfter(response.body);
+            spdlog::warn("Flood limit hit for chat {}, retrying in {}s", chatId, seconds);
+            _throttled.fetch_add(1, std::memory_order_relaxed);
+
+            chat.blockedUntil = now + std::chrono::seconds(seconds);
+            chat.queue.push_front(std::move(message));
+            _queued.fetch_add(1, std::memory_order_relaxed);
+        }
+        else if (!response.ok())
+        {
+            spdlog::error("sendMessage to {} failed ({}): {}", chatId, response.status,
+                          curl_easy_strerror(response.code));
+        }
+        else
+        {
+            _sent.fetch_add(1, std::memory_order_relaxed);
+        }
+
+        if (chat.queue.empty())
+        {
+            // Forget idle chats, a fresh entry starts with a full bucket anyway
+            if (chat.blockedUntil <= now && chat.bucket.full(now))
+            {
+                _chats.erase(chatId);
+            }
+            return;
+        }
+
+        markReady(chatId, chat);
+        pump();
+    }
+
+    /// @brief Read parameters.retry_after from a 429 response.
+    /// @param body[in] Response body.
+    /// @return Seconds to wait, at least one.
+    long MessageScheduler::retryAfter(const std::string &body)
+    {
+        Json::CharReaderBuilder builder;
+        const std::unique_ptr<Json::CharReader> reader(builder.newCharReader());
+        Json::Value root;
+        std::string errors;
+        if (!reader->parse(body.data(), body.data() + body.size(), &root, &errors))
+        {
+            return 1;
+        }
+        return std::max<long>(1, root["parameters"].get("retry_after", 1).asInt());
+    }
+
+    /// @brief Percent-encode a form value.
+    /// @param value[in] Raw value.
+    /// @return The encoded value.
+    std::string MessageScheduler::encodeForm(const std::string &value)
+    {
+        static const char hex[] = "0123456789ABCDEF";
+
+        std::string encoded;
+        encoded.reserve(value.size() * 3);
+        for (const unsigned char c : value)
+        {
+            if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+            {
+                encoded += static_cast<char>(c);
+            }
+            else
+            {
+                encoded += '%';
+                encoded += hex[c >> 4];
+                encoded += hex[c & 0x0F];
+            }
+        }
+        return encoded;
+    }
+
+} // !namespace messageScheduler
@@ -0,0 +1,58 @@
+#include "include/metrics.h"
+
+namespace metrics
+{
+    /// @brief Get the process-wide registry.
+    /// @param none.
+    /// @return The registry.
+    Metrics &Metrics::instance()
+    {
+        static Metrics registry;
+        return registry;
+    }
+
+    /// @brief Get or create a value by name.
+    /// @param name[in] Metric name.
+    /// @return Reference to the atomic value.
+    std::atomic<std::uint64_t> &Metrics::get(const std::string &name)
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        auto &value = _values[name];
+        if (!value)
+        {
+            value = std::make_unique<std::atomic<std::uint64_t>>(0);
+        }
+        return *value;
+    }
+
+    /// @brief Raise a gauge to value if it is currently lower.
+    /// @param gauge[in] The gauge to update.
+    /// @param value[in] The candidate maximum.
+    /// @return none.
+    void Metrics::storeMax(std::atomic<std::uint64_t> &gauge, std::uint64_t value)
+    {
+        std::uint64_t current = gauge.load(std::memory_order_relaxed);
+        while (current < value &&
+               !gauge.compare_exchange_weak(current, value, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /// @brief Render every value in Prometheus text format.
+    /// @param none.
+    /// @return One "name value" line per metric.
+    std::string Metrics::render() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        std::string out;
+        for (const auto &entry : _values)
+        {
+            out += entry.first;
+            out += ' ';
+            out += std::to_string(entry.second->load(std::memory_order_relaxed));
+            out += '\n';
+        }
+        return out;
+    }
+
+} // !namespace metrics
@@ -0,0 +1,61 @@
+#include "include/network_context.h"
+
+namespace networkContext
+{
+    NetworkContext::GlobalInit::GlobalInit()
+    {
+        if (curl_global_init(CURL_GLOBAL_DEFAULT) != CURLE_OK)
+        {
+            throw std::runtime_error("Failed to initialize libcurl");
+        }
+    }
+
+    NetworkContext::GlobalInit::~GlobalInit()
+    {
+        curl_global_cleanup();
+    }
+
+    NetworkContext::NetworkContext() = default;
+
+    NetworkContext::~NetworkContext()
+    {
+        for (curl_slist *&list : _headers)
+        {
+            curl_slist_free_all(list);
+            list = nullptr;
+        }
+    }
+
+    /// @brief Set the headers sent with every API request of a platform.
+    /// @param platform[in] The platform.
+    /// @param lines[in] Header lines, e.g. "Authorization: Bearer ...".
+    /// @return none.
+    /// NOTE: not synchronized, call it before any request is made.
+    void NetworkContext::setHeaders(urlRouter::Platform platform, const std::vector<std::string> &lines)
+    {
+        curl_slist *list = nullptr;
+        for (const auto &line : lines)
+        {
+            curl_slist *next = curl_slist_append(list, line.c_str());
+            if (!next)
+            {
+                curl_slist_free_all(list);
+                throw std::runtime_error("Failed to build request headers");
+            }
+            list = next;
+        }
+
+        curl_slist *&slot = _headers[static_cast<std::size_t>(platform)];
+        curl_slist_free_all(slot);
+        slot = list;
+    }
+
+    /// @brief The prebuilt headers of a platform.
+    /// @param platform[in] The platform.
+    /// @return The list for CURLOPT_HTTPHEADER, nullptr if it has none.
+    curl_slist *NetworkContext::headers(urlRouter::Platform platform) const
+    {
+        return _headers[static_cast<std::size_t>(platform)];
+    }
+
+} // !namespace networkContext
@@ -0,0 +1,590 @@
+#include "include/metrics.h"
+#include "include/range_downloader.h"
+
+#include <fcntl.h>
+
+namespace rangeDownloader
+{
+    using metrics::Metrics;
+
+    namespace
+    {
+        /// @brief Reserve the file's blocks up front, so parallel writes do
+        /// not fragment it; a plain resize where fallocate is unsupported.
+        void preallocate(int fd, curl_off_t size)
+        {
+            if (::fallocate(fd, 0, 0, static_cast<off_t>(size)) != 0)
+            {
+                if (::ftruncate(fd, static_cast<off_t>(size)) != 0)
+                {
+                    spdlog::warn("Could not preallocate {} bytes: {}", size, std::strerror(errno));
+                }
+            }
+        }
+
+        /// @brief The value of a header line if it is the named header.
+        /// @return Empty if it is another header.
+        std::string_view headerValue(std::string_view line, std::string_view name)
+        {
+            if (line.size() <= name.size() || line[name.size()] != ':' ||
+                !boost::algorithm::iequals(line.substr(0, name.size()), name))
+            {
+                return {};
+            }
+            std::string_view value = line.substr(name.size() + 1);
+            value.remove_prefix(std::min(value.find_first_not_of(" \t"), value.size()));
+            const auto last = value.find_last_not_of(" \t\r\n");
+            return last == std::string_view::npos ? std::string_view() : value.substr(0, last + 1);
+        }
+
+    } // !namespace
+
+    /// @brief Create a downloader.
+    /// @param pool[in] Pool the transfers lease their handles from.
+    /// @param limits[in] How far a file is split.
+    RangeDownloader::RangeDownloader(curlPool::CurlPool &pool, Limits limits)
+        : _pool(pool),
+          _limits(limits),
+          _segmented(Metrics::instance().get("download_segmented_total")),
+          _single(Metrics::instance().get("download_single_total")),
+          _fallbacks(Metrics::instance().get("download_fallbacks_total")),
+          _retries(Metrics::instance().get("download_segment_retries_total")),
+          _resumed(Metrics::instance().get("download_resumed_total")),
+          _bytes(Metrics::instance().get("download_bytes_total")) {}
+
+    /// @brief Download a file, in parallel ranges when the server allows it.
+    /// @param url[in] The file's address.
+    /// @param path[in] Where to store it, replaced if it exists.
+    /// @return false if the file could not be downloaded. Nothing is left at
+    /// path then, but a partial file and its journal may be kept next to it.
+    bool RangeDownloader::download(const std::string &url, const std::string &path)
+    {
+        Probe probed;
+        const bool known = probe(url, probed);
+
+        if (known && probed.ranges && probed.size > 0)
+        {
+            bool rejected = false;
+            if (fetchResumable(probed, path, rejected))
+            {
+                return true;
+            }
+            if (!rejected)
+            {
+                spdlog::error("Failed to download {} to {}", url, path);
+                return false;
+            }
+            _fallbacks.fetch_add(1, std::memory_order_relaxed);
+            spdlog::warn("Ranged download of {} failed, retrying as one stream", url);
+        }
+        else if (known)
+        {
+            // Whatever an earlier attempt kept cannot be resumed any more
+            ::unlink((path + ".part").c_str());
+            downloadJournal::Journal(path + ".journal").remove();
+        }
+
+        _single.fetch_add(1, std::memory_order_relaxed);
+        if (!fetchSingle(known ? probed.url : url, path, known ? probed.size : -1))
+        {
+            spdlog::error("Failed to download {} to {}", url, path);
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Ask for the file's size and range support without fetching it.
+    /// @param url[in] The file's address.
+    /// @param result[out] What the server told.
+    /// @return false if the HEAD request failed, the size is unknown then.
+    bool RangeDownloader::probe(const std::string &url, Probe &result)
+    {
+        auto curl = _pool.acquire();
+        if (!curl)
+        {
+            return false;
+        }
+
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_NOBODY, 1L);
+        curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl.get(), CURLOPT_MAXREDIRS, 5L);
+        curl_easy_setopt(curl.get(), CURLOPT_HEADERFUNCTION, &RangeDownloader::readHeader);
+        curl_easy_setopt(curl.get(), CURLOPT_HEADERDATA, &result);
+
+        if (_pool.perform(curl.get()) != CURLE_OK)
+        {
+            return false;
+        }
+
+        long status = 0;
+        curl_easy_getinfo(curl.get(), CURLINFO_RESPONSE_CODE, &status);
+        if (status != 200)
+        {
+            return false;
+        }
+
+        curl_easy_getinfo(curl.get(), CURLINFO_CONTENT_LENGTH_DOWNLOAD_T, &result.size);
+        const char *effective = nullptr;
+        curl_easy_getinfo(curl.get(), CURLINFO_EFFECTIVE_URL, &effective);
+        result.url = effective ? effective : url;
+        return true;
+    }
+
+    /// @brief Fetch the missing ranges of a file into its partial file,
+    /// journaled when the server gave a validator.
+    /// @param probe[in] Size, address and validator of the file.
+    /// @param path[in] Where the complete file is moved to.
+    /// @param rejected[out] Set if the server did not serve a range, the
+    /// partial file and journal are dropped then.
+    /// @return false if a range failed after its retries.
+    bool RangeDownloader::fetchResumable(const Probe &probe, const std::string &path, bool &rejected)
+    {
+        const std::string partial = path + ".part";
+        downloadJournal::Journal journal(path + ".journal");
+
+        // Without a validator a later attempt could not tell the file changed
+        const bool resumable = !probe.validator().empty();
+        const bool resumed = resumable && journal.resume(static_cast<off_t>(probe.size), probe.validator());
+        const bool journaled = resumed || (resumable && journal.start(static_cast<off_t>(probe.size), probe.validator()));
+
+        const int fd = ::open(partial.c_str(), O_WRONLY | O_CREAT | O_CLOEXEC | (resumed ? 0 : O_TRUNC), 0644);
+        if (fd < 0)
+        {
+            spdlog::error("Could not open {}: {}", partial, std::strerror(errno));
+            journal.remove();
+            return false;
+        }
+
+        if (resumed)
+        {
+            _resumed.fetch_add(1, std::memory_order_relaxed);
+            spdlog::info("Resuming {} with {} of {} bytes on disk", path, journal.completed(), probe.size);
+        }
+        else
+        {
+            preallocate(fd, probe.size);
+        }
+
+        std::vector<downloadJournal::Range> holes{{0, static_cast<off_t>(probe.size)}};
+        if (journaled)
+        {
+            holes = journal.missing();
+        }
+        std::vector<Segment> segments = plan(holes);
+        if (segments.size() > 1)
+        {
+            _segmented.fetch_add(1, std::memory_order_relaxed);
+        }
+        const Result result = fetchSegments(probe, fd, segments, journal);
+        rejected = result == Result::Rejected;
+
+        bool ok = ::close(fd) == 0 && result == Result::Ok;
+        if (ok)
+        {
+            std::error_code ec;
+            std::filesystem::rename(partial, path, ec);
+            if (ec)
+            {
+                spdlog::error("Failed to move {} to {}: {}", partial, path, ec.message());
+                ok = false;
+            }
+        }
+
+        if (ok || rejected || !journaled)
+        {
+            ::unlink(partial.c_str());
+            journal.remove();
+        }
+        else
+        {
+            spdlog::warn("Kept {} of {} bytes of {} for a later attempt", journal.completed(), probe.size, path);
+        }
+        return ok;
+    }
+
+    /// @brief Fetch a file as one stream, straight into its path.
+    /// @param url[in] The file's address.
+    /// @param path[in] Where to store it, removed on failure.
+    /// @param sizeHint[in] The probed size to preallocate, negative if unknown.
+    /// @return false if the transfer failed.
+    bool RangeDownloader::fetchSingle(const std::string &url, const std::string &path, curl_off_t sizeHint)
+    {
+        const int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+        if (fd < 0)
+        {
+            spdlog::error("Could not open {}: {}", path, std::strerror(errno));
+            return false;
+        }
+        if (sizeHint > 0)
+        {
+            preallocate(fd, sizeHint);
+        }
+
+        curl_off_t size = 0;
+        bool ok = fetchWhole(url, fd, size);
+        // Drop what the preallocation reserved beyond the real size
+        if (ok && ::ftruncate(fd, static_cast<off_t>(size)) != 0)
+        {
+            ok = false;
+        }
+        if (::close(fd) != 0)
+        {
+            ok = false;
+        }
+        if (!ok)
+        {
+            ::unlink(path.c_str());
+        }
+        return ok;
+    }
+
+    /// @brief Fetch ranges of the file, at most maxSegments at once.
+    /// @param probe[in] Address and validator of the file.
+    /// @param fd[in] The partial file.
+    /// @param segments[in,out] The ranges, their progress is updated.
+    /// @param journal[in] Where progress is checkpointed.
+    /// @return Rejected if the server answered a range with something else,
+    /// Failed if a range failed after its retries.
+    RangeDownloader::Result RangeDownloader::fetchSegments(const Probe &probe, int fd, std::vector<Segment> &segments,
+                                                           downloadJournal::Journal &journal)
+    {
+        if (segments.empty())
+        {
+            return Result::Ok;
+        }
+
+        CURLM *multi = curl_multi_init();
+        if (!multi)
+        {
+            return Result::Failed;
+        }
+
+        // A range of a file that changed since the probe comes back whole, as a 200
+        curl_slist *headers = nullptr;
+        if (!probe.validator().empty())
+        {
+            headers = curl_slist_append(nullptr, ("If-Range: " + probe.validator()).c_str());
+            if (!headers)
+            {
+                curl_multi_cleanup(multi);
+                return Result::Failed;
+            }
+        }
+
+        const std::size_t parallel = std::min(segments.size(), std::max<std::size_t>(_limits.maxSegments, 1));
+        std::vector<curlPool::CurlPool::Lease> leases;
+        leases.reserve(parallel);
+
+        std::size_t next = 0;
+        auto launch = [&](CURL *handle)
+        {
+            Segment &segment = segments[next++];
+            segment.handle = handle;
+            segment.sink = streamSink::StreamSink(fd, static_cast<off_t>(segment.begin));
+            segment.journal = &journal;
+            segment.headers = headers;
+            start(segment, probe.url);
+            curl_multi_add_handle(multi, handle);
+        };
+
+        Result result = Result::Ok;
+        for (std::size_t i = 0; i < parallel && result == Result::Ok; ++i)
+        {
+            leases.push_back(_pool.acquire());
+            if (!leases.back())
+            {
+                // Fewer connections still get the file, none do not
+                leases.pop_back();
+                result = leases.empty() ? Result::Failed : Result::Ok;
+                break;
+            }
+            launch(leases.back().get());
+        }
+
+        std::size_t remaining = segments.size();
+        while (result == Result::Ok && remaining > 0)
+        {
+            int running = 0;
+            if (curl_multi_perform(multi, &running) != CURLM_OK)
+            {
+                result = Result::Failed;
+                break;
+            }
+
+            int queued = 0;
+            while (CURLMsg *message = curl_multi_info_read(multi, &queued))
+            {
+                if (message->msg != CURLMSG_DONE)
+                {
+                    continue;
+                }
+
+                Segment *segment = nullptr;
+                curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, &segment);
+                const CURLcode res = message->data.result;
+                curl_multi_remove_handle(multi, message->easy_handle);
+                const bool saved = checkpoint(*segment);
+
+                if (res == CURLE_OK && saved && segment->begin + segment->written == segment->end)
+                {
+                    --remaining;
+                    // Its buffer goes back for the next range
+                    segment->sink = streamSink::StreamSink();
+                    // The handle moves on to the next queued range
+                    if (next < segments.size())
+                    {
+                        launch(segment->handle);
+                    }
+                    continue;
+                }
+
+                if (segment->rejected)
+                {
+                    result = Result::Rejected;
+                    break;
+                }
+                // A dropped connection resumes where its range stopped
+                if (segment->retries++ == MAX_RETRIES)
+                {
+                    result = Result::Failed;
+                    break;
+                }
+                _retries.fetch_add(1, std::memory_order_relaxed);
+                start(*segment, probe.url);
+                curl_multi_add_handle(multi, segment->handle);
+            }
+
+            if (result == Result::Ok && remaining > 0)
+            {
+                curl_multi_poll(multi, nullptr, 0, 1000, nullptr);
+            }
+        }
+
+        for (Segment &segment : segments)
+        {
+            if (segment.handle)
+            {
+                curl_multi_remove_handle(multi, segment.handle);
+                checkpoint(segment);
+            }
+            _bytes.fetch_add(static_cast<std::uint64_t>(segment.written), std::memory_order_relaxed);
+        }
+        curl_multi_cleanup(multi);
+        curl_slist_free_all(headers);
+        return result;
+    }
+
+    /// @brief Fetch the file as one stream.
+    /// @param url[in] The file's address.
+    /// @param fd[in] The file, written from its start.
+    /// @param size[out] Bytes written.
+    /// @return false if the transfer failed.
+    bool RangeDownloader::fetchWhole(const std::string &url, int fd, curl_off_t &size)
+    {
+        auto curl = _pool.acquire();
+        if (!curl)
+        {
+            return false;
+        }
+
+        Segment segment;
+        segment.handle = curl.get();
+        segment.sink = streamSink::StreamSink(fd, 0);
+        start(segment, url);
+
+        CURLcode res = _pool.perform(curl.get());
+        if (!checkpoint(segment) && res == CURLE_OK)
+        {
+            res = CURLE_WRITE_ERROR;
+        }
+        size = segment.written;
+        _bytes.fetch_add(static_cast<std::uint64_t>(segment.written), std::memory_order_relaxed);
+        if (res != CURLE_OK)
+        {
+            spdlog::error("Failed to download {}: {}", url, curl_easy_strerror(res));
+            return false;
+        }
+        return true;
+    }
+
+    /// @brief Split the missing parts of a file into ranges.
+    /// @param holes[in] The missing parts, in file order.
+    /// @return Ranges of about equal size, none smaller than minSegmentSize
+    /// unless a hole is.
+    std::vector<RangeDownloader::Segment> RangeDownloader::plan(const std::vector<downloadJournal::Range> &holes) const
+    {
+        std::vector<Segment> segments;
+        curl_off_t missing = 0;
+        for (const auto &hole : holes)
+        {
+            missing += hole.end - hole.begin;
+        }
+        if (missing == 0)
+        {
+            return segments;
+        }
+
+        const auto count = static_cast<curl_off_t>(segmentsFor(missing));
+        const curl_off_t target = (missing + count - 1) / count;
+        for (const auto &hole : holes)
+        {
+            const curl_off_t length = hole.end - hole.begin;
+            const curl_off_t pieces = (length + target - 1) / target;
+            const curl_off_t step = (length + pieces - 1) / pieces;
+            for (curl_off_t begin = hole.begin; begin < hole.end; begin += step)
+            {
+                Segment segment;
+                segment.ranged = true;
+                segment.begin = begin;
+                segment.end = std::min<curl_off_t>(begin + step, hole.end);
+                segments.push_back(std::move(segment));
+            }
+        }
+        return segments;
+    }
+
+    /// @brief (Re)start the transfer of a segment from where it stopped.
+    /// @param segment[in,out] The segment.
+    /// @param url[in] The file's address.
+    /// @return none.
+    void RangeDownloader::start(Segment &segment, const std::string &url)
+    {
+        CURL *handle = segment.handle;
+        segment.checked = false;
+
+        curl_easy_setopt(handle, CURLOPT_URL, url.c_str());
+        curl_easy_setopt(handle, CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(handle, CURLOPT_MAXREDIRS, 5L);
+        curl_easy_setopt(handle, CURLOPT_FAILONERROR, 1L);
+        curl_easy_setopt(handle, CURLOPT_WRITEFUNCTION, &RangeDownloader::writeSegment);
+        curl_easy_setopt(handle, CURLOPT_WRITEDATA, &segment);
+        curl_easy_setopt(handle, CURLOPT_PRIVATE, &segment);
+        curl_easy_setopt(handle, CURLOPT_HTTPHEADER, segment.headers);
+        // Give up on a stalled connection instead of waiting forever
+        curl_easy_setopt(handle, CURLOPT_LOW_SPEED_LIMIT, 1024L);
+        curl_easy_setopt(handle, CURLOPT_LOW_SPEED_TIME, 30L);
+
+        if (segment.ranged)
+        {
+            const std::string range = std::to_string(segment.begin + segment.written) + "-" +
+                                      std::to_string(segment.end - 1);
+            curl_easy_setopt(handle, CURLOPT_RANGE, range.c_str());
+        }
+        else
+        {
+            curl_easy_setopt(handle, CURLOPT_RANGE, nullptr);
+        }
+    }
+
+    /// @brief Number of ranges a file of this size is split into.
+    /// @param size[in] The file size, negative if unknown.
+    /// @return 1 for unknown and small sizes, at most maxSegments.
+    std::size_t RangeDownloader::segmentsFor(curl_off_t size) const
+    {
+        if (size <= 0 || _limits.minSegmentSize == 0)
+        {
+            return 1;
+        }
+        const auto count = static_cast<std::uint64_t>(size) / _limits.minSegmentSize;
+        return static_cast<std::size_t>(std::clamp<std::uint64_t>(count, 1, std::max<std::size_t>(_limits.maxSegments, 1)));
+    }
+
+    /// @brief Flush what a segment took in, then record it in the journal.
+    /// @param segment[in,out] The segment.
+    /// @return false if the flush failed, written is moved back to what is
+    /// on disk then, so a retry fetches the lost bytes again.
+    bool RangeDownloader::checkpoint(Segment &segment)
+    {
+        if (!segment.sink.flush())
+        {
+            segment.written = static_cast<curl_off_t>(segment.sink.flushed());
+            return false;
+        }
+        if (segment.journal && segment.written > segment.journaled)
+        {
+            segment.journal->record(static_cast<off_t>(segment.begin),
+                                    static_cast<off_t>(segment.begin + segment.written));
+            segment.journaled = segment.written;
+        }
+        return true;
+    }
+
+    /// @brief curl write callback passing a segment's bytes to its sink.
+    /// @return 0 to abort when the server ignored the range or the write failed.
+    size_t RangeDownloader::writeSegment(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        auto *segment = static_cast<Segment *>(userdata);
+        const size_t bytes = size * nmemb;
+
+        if (segment->ranged && !segment->checked)
+        {
+            // A 200 is the whole file, writing it at the range offset would corrupt it
+            long status = 0;
+            curl_easy_getinfo(segment->handle, CURLINFO_RESPONSE_CODE, &status);
+            if (status != 206)
+            {
+                segment->rejected = true;
+                return 0;
+            }
+            segment->checked = true;
+        }
+
+        const curl_off_t offset = segment->begin + segment->written;
+        if (segment->end >= 0 && offset + static_cast<curl_off_t>(bytes) > segment->end)
+        {
+            segment->rejected = true;
+            return 0;
+        }
+
+        if (!segment->sink.write(ptr, bytes))
+        {
+            segment->written = static_cast<curl_off_t>(segment->sink.flushed());
+            return 0;
+        }
+        segment->written += static_cast<curl_off_t>(bytes);
+
+        if (segment->written - segment->journaled >= JOURNAL_STEP && !checkpoint(*segment))
+        {
+            return 0;
+        }
+        return bytes;
+    }
+
+    /// @brief curl header callback reading range support and validators.
+    /// @return The number of bytes consumed.
+    /// NOTE: every response of a redirect chain passes through here, only
+    /// the last one counts.
+    size_t RangeDownloader::readHeader(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        auto *result = static_cast<Probe *>(userdata);
+        const size_t bytes = size * nmemb;
+        const std::string_view line(ptr, bytes);
+
+        static constexpr std::string_view status = "HTTP/";
+
+        if (line.substr(0, status.size()) == status)
+        {
+            result->ranges = false;
+            result->etag.clear();
+            result->lastModified.clear();
+        }
+        else if (const auto ranges = headerValue(line, "accept-ranges"); !ranges.empty())
+        {
+            result->ranges = boost::algorithm::iequals(ranges, "bytes");
+        }
+        else if (const auto etag = headerValue(line, "etag"); !etag.empty())
+        {
+            if (etag.substr(0, 2) != "W/")
+            {
+                result->etag = etag;
+            }
+        }
+        else if (const auto modified = headerValue(line, "last-modified"); !modified.empty())
+        {
+            result->lastModified = modified;
+        }
+        return bytes;
+    }
+
+} // !namespace rangeDownloader
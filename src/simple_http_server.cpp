@@ -1,69 +1,130 @@
 #include "include/sipeto.h"
+#include "include/metrics.h"
 #include "include/simple_http_server.h"
 
 namespace simpleHttpServer
 {
     /// @brief simple http server constructor
-    /// @param ioc
-    /// @param endpoint
-    SimpleHttpServer::SimpleHttpServer(boost::asio::io_context &ioc, const tcp::endpoint &endpoint, sipeto::Sipeto &sipeto)
-        : _sipeto(sipeto), _acceptor(std::make_unique<tcp::acceptor>(ioc))
+    /// @param ioc io_context shared by every I/O thread
+    /// @param endpoint address and port to listen on
+    /// @param sipeto bot instance
+    /// @param threadCount number of threads running the io_context
+    /// @param reusePort open one SO_REUSEPORT acceptor per thread
+    SimpleHttpServer::SimpleHttpServer(boost::asio::io_context &ioc,
+                                       const tcp::endpoint &endpoint,
+                                       sipeto::Sipeto &sipeto,
+                                       std::size_t threadCount,
+                                       bool reusePort)
+        : _sipeto(sipeto), _ioc(ioc), _threadCount(std::max<std::size_t>(threadCount, 1))
+    {
+        /// NOTE: Telegram updates are small, anything larger is rejected with 413.
+        _bodyLimit = std::strtoull(_sipeto.getFromConfigMapOr("maxBodySize", "1048576").c_str(), nullptr, 10);
+
+        /// NOTE: with "webhookReply" the first reply of an update is sent back in
+        /// the webhook response, if the workers produce it within the timeout.
+        if (_sipeto.getFromConfigMapOr("webhookReply", "false") == "true")
+        {
+            _replyTimeout = std::chrono::milliseconds(std::strtoull(
+                _sipeto.getFromConfigMapOr("webhookReplyTimeout", "2000").c_str(), nullptr, 10));
+        }
+
+        const std::size_t acceptorCount = reusePort ? _threadCount : 1;
+
+        for (std::size_t i = 0; i < acceptorCount; ++i)
+        {
+            auto acceptor = std::make_unique<tcp::acceptor>(_ioc);
+            if (!openAcceptor(*acceptor, endpoint, reusePort))
+            {
+                return;
+            }
+            _acceptors.push_back(std::move(acceptor));
+        }
+
+        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Server listening with {} acceptor(s) and {} thread(s).",
+                            _acceptors.size(), _threadCount);
+    }
+
+    /// @brief open, configure, bind and listen on an acceptor
+    /// @param acceptor acceptor to open
+    /// @param endpoint address and port to listen on
+    /// @param reusePort set SO_REUSEPORT on the acceptor
+    /// @return true if the acceptor is listening
+    bool SimpleHttpServer::openAcceptor(tcp::acceptor &acceptor, const tcp::endpoint &endpoint, bool reusePort)
     {
         boost::system::error_code ec;
 
         // Open the acceptor
-        _acceptor->open(endpoint.protocol(), ec);
+        acceptor.open(endpoint.protocol(), ec);
         if (ec)
         {
             SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to open the acceptor: {}", ec.message());
-            return;
+            return false;
         }
 
         // Allow address reuse
-        _acceptor->set_option(boost::asio::socket_base::reuse_address(true), ec);
+        acceptor.set_option(boost::asio::socket_base::reuse_address(true), ec);
         if (ec)
         {
             SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to set acceptor option: {}", ec.message());
-            return;
+            return false;
+        }
+
+#ifdef SO_REUSEPORT
+        // Let several acceptors share the port, the kernel balances between them
+        if (reusePort)
+        {
+            using reuse_port = boost::asio::detail::socket_option::boolean<SOL_SOCKET, SO_REUSEPORT>;
+            acceptor.set_option(reuse_port(true), ec);
+            if (ec)
+            {
+                SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to set SO_REUSEPORT: {}", ec.message());
+                return false;
+            }
         }
+#endif
 
         // Bind to the server address
-        _acceptor->bind(endpoint, ec);
+        acceptor.bind(endpoint, ec);
         if (ec)
         {
             SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to bind the acceptor: {}", ec.message());
-            return;
+            return false;
         }
 
         // Start listening for connections
-        _acceptor->listen(boost::asio::socket_base::max_listen_connections, ec);
+        acceptor.listen(boost::asio::socket_base::max_listen_connections, ec);
         if (ec)
         {
             SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to listen on the acceptor: {}", ec.message());
-            return;
+            return false;
         }
+
+        return true;
     }
 
-    /// @brief run the http server
+    /// @brief run the http server, blocks until the io_context is stopped
     /// @param none
     /// @return none
     void SimpleHttpServer::run()
     {
         spdlog::info("Running the Server.");
-        if (!_acceptor || !_acceptor->is_open())
+        if (_acceptors.empty() || !_acceptors.front()->is_open())
         {
             SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Acceptor is not open");
             return;
         }
 
-        setwebHookUrl();
-        createSession();
-        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> workGuard(_ioc.get_executor());
-        _ioc.run();
-        // createSession();
+        start();
+
+        // Block until every I/O thread has returned
+        for (auto &thread : _threads)
+        {
+            thread.join();
+        }
+        _threads.clear();
     }
 
-    /// @brief start the http server
+    /// @brief start the http server on background threads
     /// @param none
     /// @return none
     void SimpleHttpServer::start()
@@ -74,59 +135,78 @@ namespace simpleHttpServer
         createSession();
 
         // Keep the io_context alive to prevent the server from stopping prematurely
-        boost::asio::executor_work_guard<boost::asio::io_context::executor_type> workGuard(_ioc.get_executor());
+        _workGuard = std::make_unique<boost::asio::executor_work_guard<
+            boost::asio::io_context::executor_type>>(_ioc.get_executor());
 
-        // Run the io_context in a separate thread
-        std::thread([&]
-                    { _ioc.run(); })
-            .detach();
+        // Run the io_context on the configured number of threads
+        _threads.reserve(_threadCount);
+        for (std::size_t i = 0; i < _threadCount; ++i)
+        {
+            _threads.emplace_back([this]
+                                  { _ioc.run(); });
+        }
     }
 
-    void SimpleHttpServer::doAccept()
+    /// @brief stop the io_context and join the I/O threads
+    /// @param none
+    /// @return none
+    void SimpleHttpServer::stop()
     {
-        _acceptor->async_accept(
-            [this](boost::system::error_code ec, tcp::socket socket)
+        _workGuard.reset();
+        _ioc.stop();
+
+        for (auto &thread : _threads)
+        {
+            if (thread.joinable() && thread.get_id() != std::this_thread::get_id())
             {
-                if (!ec)
-                {
-                    std::make_shared<Session>(std::move(socket), _sipeto, *_acceptor)->start();
-                }
-                doAccept();
-            });
+                thread.join();
+            }
+        }
+        _threads.clear();
     }
 
-    /// @brief create a session
-    /// @param none
+    /// @brief accept connections on an acceptor, one strand per session
+    /// @param acceptor acceptor to accept on
     /// @return none
-    void SimpleHttpServer::createSession()
+    void SimpleHttpServer::doAccept(tcp::acceptor &acceptor)
     {
-        spdlog::info("Creating Session...");
-        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Creating session...");
-
-        _acceptor->async_accept(
-            [this](boost::system::error_code ec, tcp::socket socket)
+        acceptor.async_accept(
+            boost::asio::make_strand(_ioc),
+            [this, &acceptor](boost::system::error_code ec, tcp::socket socket)
             {
                 if (!ec)
                 {
-                    spdlog::info("Session accepted.");
                     SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Session accepted.");
-                    auto session = std::make_shared<Session>(std::move(socket), _sipeto, *_acceptor);
-                    _sessions.push_back(session);
-                    SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Session created.");
-                    session->start();
+                    std::make_shared<Session>(std::move(socket), _sipeto, acceptor,
+                                              _bodyLimit, _replyTimeout)
+                        ->start();
+                }
+                else if (ec == boost::asio::error::operation_aborted)
+                {
+                    return;
                 }
                 else
                 {
-                    spdlog::info("Failed to accept session: {}", ec.message());
-                    spdlog::error("Failed to accept session: {}", ec.message());
                     SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to accept session: {}", ec.message());
                 }
 
-                createSession();
+                doAccept(acceptor);
             });
+    }
+
+    /// @brief start accepting sessions on every acceptor
+    /// @param none
+    /// @return none
+    void SimpleHttpServer::createSession()
+    {
+        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Creating session...");
+
+        for (auto &acceptor : _acceptors)
+        {
+            doAccept(*acceptor);
+        }
 
         SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "createSession method completed.");
-        _sipeto.getLogger()->debug("CreateSession method completed.");
     }
 
     /// @brief write callback function for curl
@@ -150,11 +230,33 @@ namespace simpleHttpServer
     void SimpleHttpServer::setwebHookUrl()
     {
         _sipeto.getLogger()->debug("Setting up webHookUrl...");
+
+        std::string method = "setWebhook?url=";
+        method += _sipeto.getFromConfigMap("webHookUrl");
+        method += "&webhook_use_self_signed=true";
+        method += "&allowed_updates=";
+        method += sipeto::Sipeto::_allowedUpdates;
+
+        // Do not hold up the server start, the I/O threads deliver the result
+        if (auto *client = _sipeto.getBotClient())
+        {
+            client->call(method, std::string(),
+                         [this](botApiClient::BotApiClient::Response response)
+                         {
+                             if (response.code != CURLE_OK)
+                             {
+                                 spdlog::error("setWebhook failed: {}", curl_easy_strerror(response.code));
+                                 return;
+                             }
+                             handleSetWebHookUrlResponse(response.body);
+                         });
+            return;
+        }
+
         std::string url = _sipeto.getFromConfigMap("endpoint");
         url += _sipeto.getFromConfigMap("token");
-        url += "/setWebhook?url=";
-        url += _sipeto.getFromConfigMap("webHookUrl");
-        url += "&webhook_use_self_signed=true";
+        url += "/";
+        url += method;
 
         CURL *curl = curl_easy_init();
         if (!curl)
@@ -173,7 +275,7 @@ namespace simpleHttpServer
         }
         else
         {
-            handleSetWebHookUrlResponse();
+            handleSetWebHookUrlResponse(_responseBuffer.str());
         }
 
         // Cleanup
@@ -181,11 +283,10 @@ namespace simpleHttpServer
     }
 
     /// @brief handle response from setWebHookUrl
-    /// @param none
+    /// @param responseString body returned by setWebhook
     /// @return none
-    void SimpleHttpServer::handleSetWebHookUrlResponse()
+    void SimpleHttpServer::handleSetWebHookUrlResponse(const std::string &responseString)
     {
-        std::string responseString = _responseBuffer.str();
         Json::Value responseJson;
         Json::Reader reader;
         if (!reader.parse(responseString, responseJson))
@@ -217,88 +318,107 @@ namespace simpleHttpServer
     /*!SimpleHttpServer */
 
     /// @brief simple http server session constructor
-    SimpleHttpServer::Session::Session(tcp::socket socket, sipeto::Sipeto &sipeto, tcp::acceptor &acceptor)
+    SimpleHttpServer::Session::Session(tcp::socket socket, sipeto::Sipeto &sipeto,
+                                       tcp::acceptor &acceptor, std::uint64_t bodyLimit,
+                                       std::chrono::milliseconds replyTimeout)
         : _socket(std::move(socket)),
           _sipeto(sipeto),
-          _acceptor(acceptor) {}
+          _acceptor(acceptor),
+          _bodyLimit(bodyLimit),
+          _replyTimeout(replyTimeout),
+          _replyTimer(_socket.get_executor()) {}
 
     /// @brief Start the asynchronous operation
     /// @param none
     /// @return none
     void SimpleHttpServer::Session::start()
     {
-        spdlog::info("Starting session...");
+        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Starting session...");
         readRequest();
     }
 
-    void SimpleHttpServer::Session::doRead()
-    {
-        // Read a request
-        http::async_read(_socket, _buffer, _req,
-                         [this](boost::system::error_code ec, std::size_t)
-                         {
-                             if (!ec)
-                             {
-                                 handleRequest();
-                             }
-                             else if (ec != boost::asio::error::operation_aborted)
-                             {
-                                 handleRequestError(ec.message());
-                             }
-                         });
-    }
-
-    /// @brief read incoming requests from Telegram bot
+    /// @brief read the next request on the connection
     /// @param none
     /// @return none
+    /// NOTE: header and body are parsed once, straight out of _buffer.
+    /// Leftover bytes stay in _buffer for the next pipelined request.
     void SimpleHttpServer::Session::readRequest()
     {
         SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Reading request...");
 
+        // A parser can only be used once, start a fresh one per request
+        _parser.emplace();
+        _parser->body_limit(_bodyLimit);
+
         auto self = shared_from_this();
+        http::async_read(_socket, _buffer, *_parser,
+                         [self](boost::system::error_code ec, std::size_t bytesTransferred)
+                         { self->onRead(ec, bytesTransferred); });
+    }
 
-        http::async_read(_socket, _buffer, _req, [self, this](boost::system::error_code ec, std::size_t bytesTransferred)
-                         {
-        if (ec) {
-            handleRequestError("Failed to read request: " + ec.message());
+    /// @brief dispatch a request once it has been fully read
+    /// @param ec read result
+    /// @param bytesTransferred number of bytes consumed by the parser
+    /// @return none
+    void SimpleHttpServer::Session::onRead(boost::system::error_code ec, std::size_t bytesTransferred)
+    {
+        // The client closed a keep-alive connection between requests
+        if (ec == http::error::end_of_stream)
+        {
+            closeSocket();
             return;
         }
 
-        // Store the buffer data before it's consumed by the parser
-        std::string requestString(static_cast<const char*>(_buffer.data().data()), _buffer.data().size());
+        if (ec == http::error::body_limit)
+        {
+            SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Request body exceeds {} bytes", _bodyLimit);
+            writeResponse(makeResponse(http::status::payload_too_large, false));
+            return;
+        }
 
-        // Create an HTTP request object and parse the received data into it
-        http::request_parser<http::empty_body> parser;
-        boost::beast::error_code parseError;
-        parser.put(_buffer.data(), parseError);
-        if (parseError) {
-            handleRequestError("Failed to parse request: " + parseError.message() + ", request string: " + requestString);
+        if (ec)
+        {
+            if (ec != boost::asio::error::operation_aborted)
+            {
+                SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), "Failed to read request: {}", ec.message());
+            }
+            closeSocket();
             return;
         }
-        _req = parser.release();
 
-        if (_req.target().empty() || _req.method() == http::verb::unknown) {
+        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Read {} bytes of request data", bytesTransferred);
+
+        _req = _parser->release();
+
+        if (_req.target().empty() || _req.method() == http::verb::unknown)
+        {
             handleRequestError("Invalid request: missing target or unknown method");
             return;
         }
 
-        switch (_req.method()) {
-            case http::verb::get:
-                self->handleRequest();
-                break;
-            default:
-                handleMethodNotAllowed();
-                break;
+        switch (_req.method())
+        {
+        case http::verb::get:
+        case http::verb::post:
+            handleRequest();
+            break;
+        default:
+            handleMethodNotAllowed();
+            break;
         }
+    }
 
-        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Read {} bytes of request data", bytesTransferred);
-
-        // If the entire request data has not been read, continue reading asynchronously
-        if (_req.need_eof()) {
-            return;
-        } else {
-            readRequest();
-        } });
+    /// @brief build an empty response matching the current request
+    /// @param status HTTP status
+    /// @param keepAlive keep the connection open after the response
+    /// @return the prepared response
+    http::response<http::string_body> SimpleHttpServer::Session::makeResponse(http::status status, bool keepAlive) const
+    {
+        http::response<http::string_body> res{status, _req.version()};
+        res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+        res.keep_alive(keepAlive);
+        res.prepare_payload();
+        return res;
     }
 
     /// @brief handle errors in incoming requests from Telegram bot.
@@ -308,22 +428,14 @@ namespace simpleHttpServer
     {
         SPDLOG_LOGGER_ERROR(_sipeto.getLogger(), errorMessage);
 
-        // Generate an HTTP response with status 400 Bad Request
-        http::response<http::string_body> badRequestRes{http::status::bad_request, _req.version()};
-        badRequestRes.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-        badRequestRes.keep_alive(_req.keep_alive());
-        badRequestRes.prepare_payload();
-        writeResponse(badRequestRes);
+        // Respond with 400 Bad Request and drop the connection
+        writeResponse(makeResponse(http::status::bad_request, false));
     }
 
     void SimpleHttpServer::Session::handleMethodNotAllowed()
     {
         // Generate an HTTP response with status 405 Method Not Allowed
-        http::response<http::string_body> methodNotAllowedRes{http::status::method_not_allowed, _req.version()};
-        methodNotAllowedRes.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-        methodNotAllowedRes.keep_alive(_req.keep_alive());
-        methodNotAllowedRes.prepare_payload();
-        writeResponse(methodNotAllowedRes);
+        writeResponse(makeResponse(http::status::method_not_allowed, _req.keep_alive()));
     }
 
     /// @brief handle incoming requests from Telegram bot
@@ -331,98 +443,166 @@ namespace simpleHttpServer
     /// @return none
     void SimpleHttpServer::Session::handleRequest()
     {
-        spdlog::info("Handling request...");
+        SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Handling request...");
 
         // Check if the incoming request is a Telegram bot update
         if (_req.target() == "/" + _sipeto.getFromConfigMap("token"))
         {
-            spdlog::info("Received Telegram bot update");
+            if (_req.method() != http::verb::post)
+            {
+                handleMethodNotAllowed();
+                return;
+            }
+
+            SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Received Telegram bot update");
             // Process Telegram bot update
             processTelegramUpdate();
         }
+        else if (_req.target() == "/metrics" && _req.method() == http::verb::get)
+        {
+            http::response<http::string_body> res{http::status::ok, _req.version()};
+            res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
+            res.set(http::field::content_type, "text/plain; version=0.0.4");
+            res.keep_alive(_req.keep_alive());
+            res.body() = metrics::Metrics::instance().render();
+            res.prepare_payload();
+            writeResponse(std::move(res));
+        }
         else
         {
-            spdlog::info("Received HTTP request");
+            SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Received HTTP request");
             // Process request using Sipeto class (existing implementation)
-            std::string result = _sipeto.processRequest(_reqString.body());
+            std::string result = _sipeto.processRequest(_req.body());
 
             // Generate the HTTP response (existing implementation)
             http::response<http::string_body> res{http::status::ok, _req.version()};
             res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
             res.set(http::field::content_type, "text/plain");
             res.keep_alive(_req.keep_alive());
-            res.body() = result;
+            res.body() = std::move(result);
             res.prepare_payload();
-            writeResponse(res);
+            writeResponse(std::move(res));
         }
     }
 
-    /// @brief write response to the client
-    /// @param bad_request_res HTTP response with status 400 Bad Request
+    /// @brief write response to the client, then read the next request
+    /// @param response HTTP response, owned by the session until written
     /// @return none
-    void SimpleHttpServer::Session::writeResponse(const http::response<http::string_body> &response)
+    void SimpleHttpServer::Session::writeResponse(http::response<http::string_body> &&response)
     {
+        _res = std::move(response);
+
         auto self = shared_from_this();
-        http::async_write(_socket, response,
-                          [self, response](boost::system::error_code ec, std::size_t)
+        http::async_write(_socket, _res,
+                          [self](boost::system::error_code ec, std::size_t)
                           {
                               if (ec)
                               {
                                   spdlog::error("Error writing response: {}", ec.message());
+                                  self->closeSocket();
                                   return;
                               }
+
                               if (self->_res.need_eof())
                               {
-                                  boost::system::error_code ec;
-                                  self->_socket.shutdown(tcp::socket::shutdown_send, ec);
-                                  if (ec)
-                                  {
-                                      spdlog::error("Error shutting down socket: {}", ec.message());
-                                      return;
-                                  }
-                              }
-                              if (response.result() == http::status::bad_request)
-                              {
-                                  boost::system::error_code ec;
-                                  self->_socket.close(ec);
-                                  if (ec)
-                                  {
-                                      spdlog::error("Error closing socket: {}", ec.message());
-                                      return;
-                                  }
+                                  self->closeSocket();
+                                  return;
                               }
+
+                              // Keep-alive: wait for the next update on the same connection
+                              self->_res = {};
+                              self->readRequest();
                           });
     }
 
-    /// @brief process Telegram bot update
+    /// @brief gracefully shut down and close the connection
+    /// @param none
+    /// @return none
+    void SimpleHttpServer::Session::closeSocket()
+    {
+        boost::system::error_code ec;
+        _socket.shutdown(tcp::socket::shutdown_send, ec);
+        _socket.close(ec);
+        if (ec)
+        {
+            spdlog::error("Error closing socket: {}", ec.message());
+        }
+    }
+
+    /// @brief queue a Telegram bot update and acknowledge it
     /// @param none
     /// @return none
+    /// NOTE: the update is processed by the Sipeto workers, so slow
+    /// downstream work never holds the webhook response or this thread.
+    /// With inline replies enabled the response waits, at most
+    /// _replyTimeout, for the first Bot API method the workers produce.
     void SimpleHttpServer::Session::processTelegramUpdate()
     {
-        // Parse the request body as JSON
-        Json::CharReaderBuilder builder;
-        Json::Value update;
-        std::string errors;
-        std::istringstream ss(_reqString.body());
-        if (!Json::parseFromStream(builder, ss, &update, &errors))
-        {
-            // If parsing fails, return an HTTP response with status 400 Bad Request
-            http::response<http::string_body> badRequestRes{http::status::bad_request, _req.version()};
-            badRequestRes.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-            badRequestRes.keep_alive(_req.keep_alive());
-            badRequestRes.prepare_payload();
-            writeResponse(badRequestRes);
+        if (!_sipeto.wantsUpdate(_req.body()))
+        {
+            // Nothing to act on, acknowledge without decoding it
+            writeResponse(makeResponse(http::status::ok, _req.keep_alive()));
             return;
         }
 
-        // Pass the JSON data to the Sipeto class for further processing
-        _sipeto.processTelegramUpdate(update);
+        std::shared_ptr<updateQueue::WebhookReply> reply;
+        if (_replyTimeout.count() > 0)
+        {
+            auto self = shared_from_this();
+            reply = std::make_shared<updateQueue::WebhookReply>(
+                [self](std::string method)
+                {
+                    // Called from a worker, hop back onto the session strand
+                    boost::asio::post(self->_socket.get_executor(),
+                                      [self, method = std::move(method)]() mutable
+                                      { self->writeWebhookReply(std::move(method)); });
+                });
+        }
 
-        // Generate an HTTP response with status 200 OK
-        http::response<http::string_body> res{http::status::ok, _req.version()};
-        res.set(http::field::server, BOOST_BEAST_VERSION_STRING);
-        res.keep_alive(_req.keep_alive());
-        res.prepare_payload();
-        writeResponse(res);
+        switch (_sipeto.enqueueUpdate(std::move(_req.body()), reply))
+        {
+        case updateQueue::PushResult::Queued:
+            if (reply)
+            {
+                // Fall back to an empty 200 if the workers are too slow
+                _replyTimer.expires_after(_replyTimeout);
+                _replyTimer.async_wait([reply](boost::system::error_code ec)
+                                       {
+                                           if (!ec)
+                                           {
+                                               reply->close();
+                                           } });
+                return;
+            }
+            writeResponse(makeResponse(http::status::ok, _req.keep_alive()));
+            break;
+        case updateQueue::PushResult::Shed:
+        case updateQueue::PushResult::Duplicate:
+            writeResponse(makeResponse(http::status::ok, _req.keep_alive()));
+            break;
+        case updateQueue::PushResult::Rejected:
+        case updateQueue::PushResult::Closed:
+            // Telegram redelivers the update later
+            writeResponse(makeResponse(http::status::service_unavailable, _req.keep_alive()));
+            break;
+        }
+    }
+
+    /// @brief answer a webhook with the Bot API method made by the workers
+    /// @param method serialized method call, empty for a plain 200
+    /// @return none
+    void SimpleHttpServer::Session::writeWebhookReply(std::string method)
+    {
+        _replyTimer.cancel();
+
+        auto res = makeResponse(http::status::ok, _req.keep_alive());
+        if (!method.empty())
+        {
+            SPDLOG_LOGGER_DEBUG(_sipeto.getLogger(), "Replying inline: {}", method);
+            res.set(http::field::content_type, "application/json");
+            res.body() = std::move(method);
+            res.prepare_payload();
+        }
+        writeResponse(std::move(res));
     }
 }
@@ -1,3 +1,5 @@
+#include "include/metrics.h"
+#include "include/url_router.h"
 #include "include/tiktok.h"
 #include "include/twitter.h"
 #include "include/instagram.h"
@@ -6,6 +8,7 @@ namespace sipeto
 {
     std::map<std::string, std::string> Sipeto::_configMap;
     std::shared_ptr<spdlog::logger> Sipeto::_logger = spdlog::stdout_color_mt("Sipeto");
+    thread_local updateQueue::WebhookReply *Sipeto::_webhookReply = nullptr;
 
     Sipeto::Sipeto(const std::string &configFIle) : _configFile(configFIle)
     {
@@ -16,6 +19,11 @@ namespace sipeto
         }
     }
 
+    Sipeto::~Sipeto()
+    {
+        stopWorkers();
+    }
+
     /// @brief Set the config file.
     /// @param none.
     /// @return none.
@@ -42,6 +50,7 @@ namespace sipeto
             file >> root;
             validateConfigRoot(root);
             parseConfig(root);
+            configureNetwork();
         }
         catch (const std::exception &e)
         {
@@ -50,6 +59,39 @@ namespace sipeto
         }
     }
 
+    /// @brief Build the request headers of each platform, the download
+    /// and the relay limits from the config.
+    /// @param none.
+    /// @return none.
+    void Sipeto::configureNetwork()
+    {
+        std::vector<std::string> tiktokHeaders = {
+            "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:87.0) Gecko/20100101 Firefox/103.0"};
+        tiktok::TikTok tikTok;
+        const auto clientKey = tikTok.getTheMap().find("client_key");
+        if (clientKey != tikTok.getTheMap().end())
+        {
+            tiktokHeaders.push_back("Authorization: Bearer " + clientKey->second);
+        }
+        _network.setHeaders(urlRouter::Platform::TikTok, tiktokHeaders);
+
+        const std::string bearerToken = getFromConfigMapOr("bearer_token", "");
+        if (!bearerToken.empty())
+        {
+            _network.setHeaders(urlRouter::Platform::Twitter, {"Authorization: Bearer " + bearerToken});
+        }
+
+        rangeDownloader::Limits limits;
+        limits.maxSegments = static_cast<std::size_t>(std::max(1, std::atoi(getFromConfigMapOr("downloadSegments", "4").c_str())));
+        limits.minSegmentSize = std::max(1ll, std::atoll(getFromConfigMapOr("downloadSegmentSize", "2097152").c_str()));
+        _network.setDownloadLimits(limits);
+
+        // The upload limit holds for relayed and downloaded media alike
+        _relay = getFromConfigMapOr("relayMedia", "true") == "true";
+        _relayLimits.bufferSize = static_cast<std::size_t>(std::max(1ll, std::atoll(getFromConfigMapOr("relayBufferSize", "1048576").c_str())));
+        _relayLimits.maxSize = std::max(1ll, std::atoll(getFromConfigMapOr("uploadLimit", "52428800").c_str()));
+    }
+
     /// @brief Validate the config file.
     /// @param root Json object.
     /// @return none.
@@ -132,7 +174,7 @@ namespace sipeto
     /// @return true if the value is a target key, false otherwise.
     bool Sipeto::isTargetKey(const std::string &key) const
     {
-        return std::find(_targetKeys.begin(), _targetKeys.end(), key) != _targetKeys.end();
+        return _platforms.contains(key);
     }
 
     /// @brief Process the config value.
@@ -155,23 +197,6 @@ namespace sipeto
         }
     }
 
-    /// @brief Hash a string using the FNV-1a algorithm
-    /// @param str[in] The string to hash
-    /// @return The hash value of the string
-    constexpr std::size_t hashString(const char *str)
-    {
-        std::size_t hash = 14695981039346656037ULL;
-        std::size_t prime = 1099511628211ULL;
-
-        for (std::size_t i = 0; str[i] != '\0'; ++i)
-        {
-            hash ^= static_cast<std::size_t>(str[i]);
-            hash *= prime;
-        }
-
-        return hash;
-    }
-
     /// @brief Process the target keys in the config file
     /// @param configValue[in] The value of the target key
     /// @param key[in] The name of the target key
@@ -183,9 +208,9 @@ namespace sipeto
         {
             for (const auto &element : configValue)
             {
-                if (_keyMap.count(key) > 0)
+                if (const std::string_view *platform = _platforms.find(key))
                 {
-                    const std::string &socialMedia = _keyMap[key];
+                    const std::string socialMedia(*platform);
                     if (socialMedia == "TikTok")
                     {
                         tiktok::TikTok tikTok;
@@ -232,6 +257,16 @@ namespace sipeto
         return errorString;
     }
 
+    /// @brief Read an optional key from the config file
+    /// @param key[in] The key to read from the config file.
+    /// @param fallback[in] The value returned when the key is missing.
+    /// @return The value of the key or the fallback.
+    std::string Sipeto::getFromConfigMapOr(const std::string &key, const std::string &fallback) const
+    {
+        const auto it = _configMap.find(key);
+        return it != _configMap.end() ? it->second : fallback;
+    }
+
     /// @brief  Print a welcome message
     /// @param  none.
     /// @return none.
@@ -288,47 +323,78 @@ namespace sipeto
     /// return none.
     void Sipeto::setLogLevel(const std::string &level)
     {
-        spdlog::level::level_enum log_level;
-
-        switch (hash(level.c_str()))
+        static constexpr auto levels = stringSwitch::makeStringMap<spdlog::level::level_enum>({
+            {"debug", spdlog::level::debug},
+            {"info", spdlog::level::info},
+            {"warn", spdlog::level::warn},
+            {"error", spdlog::level::err},
+            {"critical", spdlog::level::critical},
+            {"off", spdlog::level::off},
+        });
+
+        const spdlog::level::level_enum *log_level = levels.find(level);
+        if (!log_level)
         {
-        case hash("debug"):
-            log_level = spdlog::level::debug;
-            break;
-        case hash("info"):
-            log_level = spdlog::level::info;
-            break;
-        case hash("warn"):
-            log_level = spdlog::level::warn;
-            break;
-        case hash("error"):
-            log_level = spdlog::level::err;
-            break;
-        case hash("critical"):
-            log_level = spdlog::level::critical;
-            break;
-        case hash("off"):
-            log_level = spdlog::level::off;
-            break;
-        default:
-            log_level = spdlog::level::debug;
             spdlog::debug("Invalid log level '{}'", level);
             return;
         }
 
-        spdlog::set_level(log_level);
+        spdlog::set_level(*log_level);
         spdlog::stdout_color_mt("sipeto");
         _logger->debug("Log level set to: {}", level);
     }
 
-    void Sipeto::sendMessage(std::string chat_id, std::string text)
+    /// @brief Send a text message to a chat.
+    /// @param chat_id[in] Target chat.
+    /// @param text[in] Message text.
+    /// @param priority[in] Interactive replies go before bulk sends.
+    /// @return none.
+    /// NOTE: the first reply for a webhook update rides back in the
+    /// webhook response, saving an outbound round trip. Other messages
+    /// go through the scheduler, which keeps within Telegram's limits.
+    void Sipeto::sendMessage(std::string chat_id, std::string text, messageScheduler::Priority priority)
     {
+        if (_webhookReply)
+        {
+            Json::Value method;
+            method["method"] = "sendMessage";
+            method["chat_id"] = chat_id;
+            method["text"] = text;
+
+            Json::StreamWriterBuilder writer;
+            writer["indentation"] = "";
+            if (_webhookReply->offer(Json::writeString(writer, method)))
+            {
+                return;
+            }
+        }
+
+        if (_scheduler)
+        {
+            _scheduler->send(std::move(chat_id), std::move(text), priority);
+            return;
+        }
+
+        std::string data = "chat_id=" + encodeUrl(chat_id) + "&text=" + encodeUrl(text);
+
+        if (_botClient)
+        {
+            _botClient->call("sendMessage", std::move(data),
+                             [chat_id](botApiClient::BotApiClient::Response response)
+                             {
+                                 if (!response.ok())
+                                 {
+                                     _logger->error("sendMessage to {} failed ({}): {}", chat_id,
+                                                    response.status, curl_easy_strerror(response.code));
+                                 }
+                             });
+            return;
+        }
+
         // Send the message using the sendMessage method of the Telegram API
         std::string url = getFromConfigMap("endpoint");
         url += getFromConfigMap("token");
         url += "/sendMessage";
-
-        std::string data = "chat_id=" + encodeUrl(chat_id) + "&text=" + encodeUrl(text);
         makeRequest(url, data);
     }
 
@@ -371,45 +437,50 @@ namespace sipeto
         return encoded_str;
     }
 
+    /// @brief Call the Bot API on a pooled, kept-alive connection.
+    /// @param url[in] Method URL.
+    /// @param data[in] Form-encoded POST fields, GET when empty.
+    /// @return The response body, empty on failure.
     std::string Sipeto::makeRequest(std::string &url, std::string data)
     {
-        CURL *curl;
-        CURLcode res;
         std::string response_string;
 
-        curl = curl_easy_init();
+        auto curl = _telegramPool.acquire();
         if (curl)
         {
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
+            curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
             if (!data.empty())
             {
-                curl_easy_setopt(curl, CURLOPT_POSTFIELDS, data.c_str());
+                curl_easy_setopt(curl.get(), CURLOPT_POSTFIELDS, data.c_str());
+            }
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &curlPool::CurlPool::appendCallback);
+            curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response_string);
+
+            CURLcode res = _telegramPool.perform(curl.get());
+            if (res != CURLE_OK)
+            {
+                _logger->error("Bot API request failed: {}", curl_easy_strerror(res));
             }
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, [](char *ptr, size_t size, size_t nmemb, void *userdata) -> size_t
-                             {
-            ((std::string*)userdata)->append(ptr, size * nmemb);
-            return size * nmemb; });
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response_string);
-            res = curl_easy_perform(curl);
-            curl_easy_cleanup(curl);
         }
 
         return response_string;
     }
 
+    /// @brief Download the media behind every link of a message.
+    /// @param update[in] A message update that is not a command.
+    /// @return none.
     void Sipeto::processUpdate(const Update &update)
     {
-        // Log the update message for debugging purposes
-        SPDLOG_DEBUG("Received update: {}", Json::FastWriter().write(update));
+        _logger->debug("Received update {} from chat {}", update.updateId, update.message.chat.id);
 
-        // Extract the relevant fields from the update message
-        std::string chatId = std::to_string(update.message.chat.id);
-        std::string userId = std::to_string(update.message.from.id);
-        std::string messageText = update.message.text;
-
-        // Process the update by sending a response message
-        std::string responseText = "You said: " + messageText;
-        sendMessage(chatId, responseText);
+        // Reused so collecting links does not allocate per update
+        thread_local std::vector<std::string_view> links;
+        links.clear();
+        if (linkExtractor::extractLinks(update.message, links) == 0)
+        {
+            return;
+        }
+        downloadLinks(update, links);
     }
 
     /// @brief: Define a function to handle the request
@@ -446,32 +517,400 @@ namespace sipeto
         return responseBody;
     }
 
-    void Sipeto::processTelegramUpdate(const Json::Value &update)
+    /// @brief Dispatch a decoded update by its type.
+    /// @param update[in] The decoded update.
+    /// @return none.
+    void Sipeto::processTelegramUpdate(const Update &update)
+    {
+        switch (update.type)
+        {
+        case updateParser::UpdateType::Message:
+        case updateParser::UpdateType::ChannelPost:
+            if (!routeCommand(update))
+            {
+                processUpdate(update);
+            }
+            break;
+        case updateParser::UpdateType::CallbackQuery:
+            // handle callback query update
+            break;
+        case updateParser::UpdateType::InlineQuery:
+            // handle inline query update
+            break;
+        default:
+            // unknown or ignored update type
+            break;
+        }
+    }
+
+    /// @brief Run the handler of a bot command.
+    /// @param update[in] A message update.
+    /// @return false if the message is not a known command.
+    /// NOTE: "/cmd@BotName args" in groups is routed like "/cmd args".
+    bool Sipeto::routeCommand(const Update &update)
     {
-        /// TODO: Implement logic to handle different types of updates
-        /// (e.g., messages, inline queries, etc.)
-        /// and send appropriate responses using the Telegram Bot API
-        /// TODO: Use switch-case instead of if-else. (map, enum)
+        static constexpr auto commands = stringSwitch::makeStringMap<CommandHandler>({
+            {"/start", &Sipeto::startCommand},
+            {"/help", &Sipeto::helpCommand},
+            {"/dl", &Sipeto::downloadCommand},
+        });
+
+        const std::string_view text = update.message.text;
+        if (text.empty() || text.front() != '/')
+        {
+            return false;
+        }
 
-        // Extract update type
-        const std::string &updateType = update["update_type"].asString();
+        const std::size_t end = std::min(text.find(' '), text.size());
+        std::string_view command = text.substr(0, end);
+        command = command.substr(0, command.find('@'));
 
-        // handle different types of updates
-        if (updateType == "message")
+        const CommandHandler *handler = commands.find(command);
+        if (!handler)
         {
-            // handle message update
+            return false;
         }
-        else if (updateType == "callback_query")
+
+        std::string_view args = text.substr(end);
+        args.remove_prefix(std::min(args.find_first_not_of(' '), args.size()));
+        (this->**handler)(update, args);
+        return true;
+    }
+
+    void Sipeto::startCommand(const Update &update, std::string_view)
+    {
+        sendMessage(std::to_string(update.message.chat.id),
+                    "Hi! Send me /dl with a social media link and I will download the media for you.");
+    }
+
+    void Sipeto::helpCommand(const Update &update, std::string_view)
+    {
+        sendMessage(std::to_string(update.message.chat.id),
+                    "/start - introduction\n"
+                    "/help - this message\n"
+                    "/dl <link> - download the media behind a link");
+    }
+
+    /// @brief Download the media of every link passed to /dl.
+    void Sipeto::downloadCommand(const Update &update, std::string_view)
+    {
+        std::vector<std::string_view> links;
+        if (linkExtractor::extractLinks(update.message, links) == 0)
         {
-            // handle callback query update
+            sendMessage(std::to_string(update.message.chat.id), "Usage: /dl <link>");
+            return;
         }
-        else if (updateType == "inline_query")
+        downloadLinks(update, links);
+    }
+
+    /// @brief Fan the links of one message out to their platforms in parallel.
+    /// @param update[in] The update the links came with.
+    /// @param links[in] The links, views into the update.
+    /// @return none.
+    /// NOTE: returns once every link is handled, so the next update of the
+    /// chat still starts after this one.
+    void Sipeto::downloadLinks(const Update &update, const std::vector<std::string_view> &links)
+    {
+        if (links.size() == 1 || !_linkPool)
         {
-            // handle inline query update
+            for (const auto link : links)
+            {
+                downloadLink(update, link);
+            }
+            return;
         }
-        else
+
+        std::vector<std::future<void>> done;
+        done.reserve(links.size());
+        for (const auto link : links)
+        {
+            std::packaged_task<void()> task([this, &update, link]
+                                            { downloadLink(update, link); });
+            done.push_back(task.get_future());
+            boost::asio::post(*_linkPool, std::move(task));
+        }
+
+        // Wait for all before rethrowing, the tasks still use the update
+        for (auto &link : done)
+        {
+            link.wait();
+        }
+        for (auto &link : done)
+        {
+            link.get();
+        }
+    }
+
+    /// @brief Hand a link to the downloader of its platform.
+    /// @param update[in] The update the link came with.
+    /// @param url[in] The link.
+    /// @return none.
+    void Sipeto::downloadLink(const Update &update, std::string_view url)
+    {
+        const std::string chatId = std::to_string(update.message.chat.id);
+
+        const urlRouter::Route route = urlRouter::route(url);
+        if (route.platform == urlRouter::Platform::Unknown)
+        {
+            sendMessage(chatId, "Unsupported link: " + std::string(url));
+            return;
+        }
+
+        // Only the TikTok downloader is complete so far
+        if (route.platform != urlRouter::Platform::TikTok)
+        {
+            sendMessage(chatId, std::string(urlRouter::platformName(route.platform)) + " links are not supported yet.");
+            return;
+        }
+
+        const std::string link(url);
+        tiktok::TikTok tikTok(link, _network);
+        if (relayMedia(chatId, tikTok, link))
+        {
+            return;
+        }
+        if (tikTok.downloadMedia() != mediaDownloader::MediaDownloader::ReturnCode::Ok)
+        {
+            sendMessage(chatId, "Failed to download " + link);
+            return;
+        }
+        if (!sendMedia(chatId, tikTok.downloadedPath(), tikTok.downloadedType()))
+        {
+            sendMessage(chatId, "Failed to send " + link);
+        }
+    }
+
+    /// @brief Upload a downloaded media file to a chat, streamed from disk.
+    /// @param chatId[in] Chat the media goes to.
+    /// @param path[in] The file.
+    /// @param type[in] What it holds, picks the send method.
+    /// @return false if it could not be sent.
+    bool Sipeto::sendMedia(const std::string &chatId, const std::string &path, mediaDownloader::MediaType type)
+    {
+        std::error_code ec;
+        const auto size = std::filesystem::file_size(path, ec);
+        if (ec)
+        {
+            _logger->error("Cannot send {}: {}", path, ec.message());
+            return false;
+        }
+        if (size > static_cast<std::uintmax_t>(_relayLimits.maxSize))
+        {
+            _logger->warn("{} is {} bytes, over the upload limit", path, size);
+            return false;
+        }
+
+        // Telegram only takes photos up to 10 MB, larger ones go as documents
+        static constexpr std::uintmax_t MAX_PHOTO_SIZE = 10 << 20;
+
+        mediaUpload::Request request;
+        request.chatId = chatId;
+        switch (type)
+        {
+        case mediaDownloader::MediaType::Video:
+            request.kind = mediaUpload::Kind::Video;
+            break;
+        case mediaDownloader::MediaType::Image:
+            request.kind = size <= MAX_PHOTO_SIZE ? mediaUpload::Kind::Photo : mediaUpload::Kind::Document;
+            break;
+        case mediaDownloader::MediaType::Audio:
+            request.kind = mediaUpload::Kind::Audio;
+            break;
+        default:
+            request.kind = mediaUpload::Kind::Document;
+            break;
+        }
+
+        return mediaUpload::MediaUploader(_telegramPool, botApiBase()).send(std::move(request), path);
+    }
+
+    /// @brief Base URL of the Bot API methods, e.g. "https://api.telegram.org/bot<token>/".
+    /// @param none.
+    /// @return The URL, ending with a slash.
+    std::string Sipeto::botApiBase()
+    {
+        return getFromConfigMap("endpoint") + getFromConfigMap("token") + "/";
+    }
+
+    /// @brief Stream a video from its CDN straight into a sendVideo upload.
+    /// @param chatId[in] Chat the video goes to.
+    /// @param downloader[in] Downloader of the link's platform.
+    /// @param link[in] The link.
+    /// @return false if nothing was sent, the caller downloads the media then.
+    /// NOTE: only videos whose size is known and within the upload limit
+    /// are relayed, the others take the download path.
+    bool Sipeto::relayMedia(const std::string &chatId, mediaDownloader::MediaDownloader &downloader,
+                            const std::string &link)
+    {
+        if (!_relay)
         {
-            // unknown update type
+            return false;
+        }
+
+        const mediaDownloader::MediaInfo media = downloader.getMediaAttributes(link);
+        if (media.type != mediaDownloader::MediaType::Video || media.urls.empty())
+        {
+            return false;
+        }
+
+        mediaRelay::MediaRelay relay(_network.pool(), _telegramPool, botApiBase(), _relayLimits);
+        mediaUpload::Request request;
+        request.chatId = chatId;
+        request.kind = mediaUpload::Kind::Video;
+        request.filename = media.id + ".mp4";
+        request.mimeType = "video/mp4";
+
+        // The addresses are ranked, the next one is tried if one fails
+        for (const auto &address : media.urls)
+        {
+            if (relay.relay(address, request) == mediaRelay::MediaRelay::Result::Sent)
+            {
+                _logger->debug("Relayed {} to chat {}", link, chatId);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    /// @brief Create the update queue and start the workers draining it.
+    /// @param count[in] Number of worker threads.
+    /// @return none.
+    void Sipeto::startWorkers(std::size_t count)
+    {
+        const auto capacity = std::strtoul(getFromConfigMapOr("queueCapacity", "1024").c_str(), nullptr, 10);
+        const auto policy = updateQueue::UpdateQueue::parsePolicy(getFromConfigMapOr("queuePolicy", "reject"));
+
+        _updateQueue = std::make_unique<updateQueue::UpdateQueue>(capacity, policy);
+        _seenUpdates = std::make_unique<updateDedup::DedupWindow>(
+            std::strtoul(getFromConfigMapOr("dedupWindow", "4096").c_str(), nullptr, 10));
+        _prefilter = getFromConfigMapOr("updatePrefilter", "true") == "true";
+        _linkPool = std::make_unique<boost::asio::thread_pool>(
+            std::max<std::size_t>(std::strtoul(getFromConfigMapOr("linkThreads", "4").c_str(), nullptr, 10), 1));
+
+        count = std::max<std::size_t>(count, 1);
+        _logger->debug("Starting {} update worker(s), queue capacity {}.", count, capacity);
+        for (std::size_t i = 0; i < count; ++i)
+        {
+            _workers.emplace_back(&Sipeto::workerLoop, this);
+        }
+    }
+
+    /// @brief Close the update queue and wait for the workers to drain it.
+    /// @param none.
+    /// @return none.
+    void Sipeto::stopWorkers()
+    {
+        if (_updateQueue)
+        {
+            _updateQueue->close();
+        }
+
+        for (auto &worker : _workers)
+        {
+            if (worker.joinable())
+            {
+                worker.join();
+            }
+        }
+        _workers.clear();
+
+        if (_linkPool)
+        {
+            _linkPool->join();
+            _linkPool.reset();
+        }
+    }
+
+    /// @brief Decide from the raw bytes whether an update is worth queueing.
+    /// @param body[in] The raw update JSON.
+    /// @return false if the update has no supported link and no command.
+    /// NOTE: a skipped update is acknowledged as processed.
+    bool Sipeto::wantsUpdate(std::string_view body)
+    {
+        if (!_prefilter)
+        {
+            return true;
+        }
+
+        static auto &checked = metrics::Metrics::instance().get("update_prefilter_checked_total");
+        static auto &skipped = metrics::Metrics::instance().get("update_prefilter_skipped_total");
+
+        checked.fetch_add(1, std::memory_order_relaxed);
+        if (updatePrefilter::mayBeRelevant(body))
+        {
+            return true;
+        }
+        skipped.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+
+    /// @brief Hand a raw update body to the workers.
+    /// @param body[in] The webhook request body.
+    /// @param reply[in] Optional slot for an inline webhook reply.
+    /// @return What happened to the update.
+    /// NOTE: updates are keyed by chat, so one chat is processed in order
+    /// while different chats run on the workers in parallel. Redeliveries
+    /// of an update already accepted are dropped here, before decoding.
+    updateQueue::PushResult Sipeto::enqueueUpdate(std::string body,
+                                                  std::shared_ptr<updateQueue::WebhookReply> reply)
+    {
+        if (!_updateQueue)
+        {
+            _logger->error("Update received before the workers were started.");
+            return updateQueue::PushResult::Closed;
+        }
+        const auto key = updateParser::keyOf(body);
+        if (!_seenUpdates->insert(key.updateId))
+        {
+            _logger->debug("Dropping redelivered update {}.", key.updateId);
+            return updateQueue::PushResult::Duplicate;
+        }
+
+        const auto result = _updateQueue->push(key.chatId, std::move(body), std::move(reply));
+        if (result == updateQueue::PushResult::Rejected || result == updateQueue::PushResult::Closed)
+        {
+            // Not accepted, so the redelivery must get through
+            _seenUpdates->forget(key.updateId);
+        }
+        return result;
+    }
+
+    /// @brief Worker thread: decode and process queued updates until closed.
+    /// @param none.
+    /// @return none.
+    void Sipeto::workerLoop()
+    {
+        // Reused so decoding escaped strings does not allocate per update
+        Update update;
+
+        updateQueue::UpdateTask task;
+        while (_updateQueue->pop(task))
+        {
+            if (!updateParser::parseUpdate(task.body, update))
+            {
+                _logger->error("Failed to parse update: {}", task.body);
+            }
+            else
+            {
+                _webhookReply = task.reply.get();
+                try
+                {
+                    processTelegramUpdate(update);
+                }
+                catch (const std::exception &e)
+                {
+                    _logger->error("Error processing update: {}", e.what());
+                }
+                _webhookReply = nullptr;
+            }
+
+            // Release the webhook response if no reply was made inline
+            if (task.reply)
+            {
+                task.reply->close();
+            }
+            _updateQueue->done(task.key);
+            task = {};
         }
     }
 
@@ -0,0 +1,156 @@
+#include "include/stream_sink.h"
+
+namespace streamSink
+{
+    namespace
+    {
+        /// Idle buffers kept for reuse, the rest are freed.
+        constexpr std::size_t MAX_IDLE = 16;
+
+        std::mutex idleMutex;
+        std::vector<std::unique_ptr<char[]>> idle;
+
+        std::unique_ptr<char[]> acquireBuffer()
+        {
+            {
+                std::lock_guard<std::mutex> lock(idleMutex);
+                if (!idle.empty())
+                {
+                    std::unique_ptr<char[]> buffer = std::move(idle.back());
+                    idle.pop_back();
+                    return buffer;
+                }
+            }
+            return std::make_unique<char[]>(StreamSink::BUFFER_SIZE);
+        }
+
+        void releaseBuffer(std::unique_ptr<char[]> buffer)
+        {
+            std::lock_guard<std::mutex> lock(idleMutex);
+            if (idle.size() < MAX_IDLE)
+            {
+                idle.push_back(std::move(buffer));
+            }
+        }
+
+    } // !namespace
+
+    /// @brief A sink writing into a file from an offset on.
+    /// @param fd[in] The file, left open by the sink.
+    /// @param offset[in] Where the first byte goes.
+    StreamSink::StreamSink(int fd, off_t offset) : _fd(fd), _offset(offset) {}
+
+    StreamSink::StreamSink(StreamSink &&other) noexcept
+        : _fd(std::exchange(other._fd, -1)),
+          _offset(other._offset),
+          _buffer(std::move(other._buffer)),
+          _used(std::exchange(other._used, 0)),
+          _flushed(std::exchange(other._flushed, 0)) {}
+
+    StreamSink &StreamSink::operator=(StreamSink &&other) noexcept
+    {
+        if (this != &other)
+        {
+            release();
+            _fd = std::exchange(other._fd, -1);
+            _offset = other._offset;
+            _buffer = std::move(other._buffer);
+            _used = std::exchange(other._used, 0);
+            _flushed = std::exchange(other._flushed, 0);
+        }
+        return *this;
+    }
+
+    /// NOTE: does not flush, a write error there could not be reported.
+    /// Whatever is still buffered is lost.
+    StreamSink::~StreamSink()
+    {
+        release();
+    }
+
+    /// @brief Append bytes to the file, through the buffer.
+    /// @param data[in] The bytes.
+    /// @param size[in] How many.
+    /// @return false if writing the file failed. The buffered bytes are
+    /// dropped then, flushed() tells where the file ends.
+    bool StreamSink::write(const char *data, std::size_t size)
+    {
+        // Nothing to gather, a block at least as large as the buffer goes as is
+        if (_used == 0 && size >= BUFFER_SIZE)
+        {
+            return writeAt(data, size);
+        }
+
+        if (!_buffer)
+        {
+            _buffer = acquireBuffer();
+        }
+        while (size > 0)
+        {
+            const std::size_t chunk = std::min(size, BUFFER_SIZE - _used);
+            std::memcpy(_buffer.get() + _used, data, chunk);
+            _used += chunk;
+            data += chunk;
+            size -= chunk;
+            if (_used == BUFFER_SIZE && !flush())
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /// @brief Write the buffered bytes to the file.
+    /// @param none.
+    /// @return false if writing the file failed, the buffer is dropped then.
+    bool StreamSink::flush()
+    {
+        if (_used == 0)
+        {
+            return true;
+        }
+        const std::size_t used = std::exchange(_used, 0);
+        return writeAt(_buffer.get(), used);
+    }
+
+    /// @brief curl write callback streaming a transfer into a sink.
+    /// @return 0 to abort the transfer when writing the file failed.
+    size_t StreamSink::writeCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+    {
+        auto *sink = static_cast<StreamSink *>(userdata);
+        const size_t bytes = size * nmemb;
+        return sink->write(ptr, bytes) ? bytes : 0;
+    }
+
+    bool StreamSink::writeAt(const char *data, std::size_t size)
+    {
+        while (size > 0)
+        {
+            const ssize_t written = ::pwrite(_fd, data, size, _offset);
+            if (written < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                spdlog::error("Failed to write a download: {}", std::strerror(errno));
+                return false;
+            }
+            data += written;
+            size -= static_cast<std::size_t>(written);
+            _offset += written;
+            _flushed += static_cast<std::uint64_t>(written);
+        }
+        return true;
+    }
+
+    void StreamSink::release()
+    {
+        if (_buffer)
+        {
+            releaseBuffer(std::move(_buffer));
+        }
+        _used = 0;
+    }
+
+} // !namespace streamSink
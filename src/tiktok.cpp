@@ -6,280 +6,465 @@ using namespace mediaDownloader;
 
 namespace tiktok
 {
-    std::map<std::string, std::string> TikTok::_configMap;
-    std::shared_ptr<spdlog::logger> TikTok::_logger = spdlog::stdout_color_mt("TikTok");
-
-    MediaDownloader::ReturnCode
-    TikTok::downloadMedia()
+    namespace
     {
-        CURL *curl;
-        CURLcode res;
-       // get the media attributes. 
-        getMediaAttributes(MEDIA_URL);
-        _logger->debug("Downloading media from TikTok URL: {}", _attributes["downloadAddr"]);
-        exit(0);
+        /// @brief Knuth-Morris-Pratt matcher fed one byte at a time, so a
+        /// pattern split across two chunks is still found.
+        class StreamMatcher
+        {
+        public:
+            explicit StreamMatcher(std::string_view pattern) : _pattern(pattern), _failure(pattern.size(), 0)
+            {
+                for (std::size_t i = 1, k = 0; i < _pattern.size(); ++i)
+                {
+                    while (k > 0 && _pattern[i] != _pattern[k])
+                    {
+                        k = _failure[k - 1];
+                    }
+                    if (_pattern[i] == _pattern[k])
+                    {
+                        ++k;
+                    }
+                    _failure[i] = k;
+                }
+            }
+
+            /// @return true when c completes the pattern.
+            bool feed(char c)
+            {
+                while (_matched > 0 && c != _pattern[_matched])
+                {
+                    _matched = _failure[_matched - 1];
+                }
+                if (c == _pattern[_matched])
+                {
+                    ++_matched;
+                }
+                if (_matched == _pattern.size())
+                {
+                    _matched = _failure[_matched - 1];
+                    return true;
+                }
+                return false;
+            }
+
+            bool idle() const { return _matched == 0; }
+            char first() const { return _pattern[0]; }
 
-        std::string filePath(getFromConfigMap("tiktokOutputPath", this->_configMap) + _attributes["id"] + ".mp4");
-        std::ofstream outputFile(filePath, std::ios::binary);
+        private:
+            std::string_view _pattern;
+            std::vector<std::size_t> _failure;
+            std::size_t _matched = 0;
+        };
 
-        if (!outputFile)
+        /// @brief Picks the media addresses out of a video page as it streams in.
+        /// NOTE: the page embeds its state as JSON, e.g.
+        /// "playAddr":"https:\u002F\u002Fv16-webapp.tiktok.com\u002F...".
+        class PageScanner
         {
-            _logger->error("Error opening output file: {}", getFromConfigMap("tiktokOutputPath", this->_configMap));
-            return MediaDownloader::ReturnCode::MediaDownloadError;
-        }
+        public:
+            /// NOTE: give up on pages that grow past this without the fields.
+            static constexpr std::size_t MAX_PAGE = 4 * 1024 * 1024;
 
+            PageScanner() : _fields{{StreamMatcher(R"("downloadAddr":")"), &downloadAddr},
+                                    {StreamMatcher(R"("playAddr":")"), &playAddr}} {}
 
-        // initialize curl
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        curl = curl_easy_init();
+            /// @brief Scan the next chunk of the page.
+            /// @return false once both addresses are found or the page is too big.
+            bool feed(const char *data, std::size_t size)
+            {
+                _seen += size;
+                const char *end = data + size;
+                while (data < end)
+                {
+                    if (_capturing)
+                    {
+                        data = capture(data, end);
+                        continue;
+                    }
 
-        if (curl)
-        {
-            curl_easy_setopt(curl, CURLOPT_URL, _attributes["downloadAddr"].c_str());
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeFileCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &outputFile);
+                    // Every pattern starts with a quote, jump to the next one
+                    if (_fields[0].matcher.idle() && _fields[1].matcher.idle())
+                    {
+                        data = static_cast<const char *>(std::memchr(data, '"', static_cast<std::size_t>(end - data)));
+                        if (!data)
+                        {
+                            break;
+                        }
+                    }
 
-            res = curl_easy_perform(curl);
+                    const char c = *data++;
+                    for (auto &field : _fields)
+                    {
+                        if (field.matcher.feed(c) && field.value->empty())
+                        {
+                            _capturing = field.value;
+                        }
+                    }
+                }
+                return !done() && _seen < MAX_PAGE;
+            }
+
+            bool done() const { return !downloadAddr.empty() && !playAddr.empty(); }
+
+            std::string downloadAddr;
+            std::string playAddr;
+
+        private:
+            struct Field
+            {
+                StreamMatcher matcher;
+                std::string *value;
+            };
 
-            if (res != CURLE_OK)
+            /// @brief Append value bytes up to the closing quote, decoding escapes.
+            const char *capture(const char *data, const char *end)
             {
-                _logger->error("curl_easy_perform() failed: {}", curl_easy_strerror(res));
-                curl_easy_cleanup(curl);
-                curl_global_cleanup();
-                outputFile.close();
-                return MediaDownloader::ReturnCode::MediaDownloadError;
+                std::string &value = *_capturing;
+                while (data < end)
+                {
+                    const char c = *data++;
+                    if (!_escape.empty())
+                    {
+                        _escape += c;
+                        unescape(value);
+                        continue;
+                    }
+                    if (c == '\\')
+                    {
+                        _escape += c;
+                    }
+                    else if (c == '"')
+                    {
+                        _capturing = nullptr;
+                        break;
+                    }
+                    else
+                    {
+                        value += c;
+                    }
+                }
+                return data;
             }
-            curl_easy_cleanup(curl);
+
+            /// @brief Finish an escape sequence once all its bytes are in.
+            void unescape(std::string &value)
+            {
+                if (_escape[1] != 'u')
+                {
+                    value += _escape[1] == 'n' ? '\n' : _escape[1] == 't' ? '\t' : _escape[1];
+                    _escape.clear();
+                    return;
+                }
+                if (_escape.size() < 6)
+                {
+                    return;
+                }
+
+                // Addresses only escape ASCII such as / and &
+                unsigned int code = 0;
+                std::from_chars(_escape.data() + 2, _escape.data() + 6, code, 16);
+                if (code < 0x80)
+                {
+                    value += static_cast<char>(code);
+                }
+                _escape.clear();
+            }
+
+            Field _fields[2];
+            std::string *_capturing = nullptr;
+            std::string _escape;
+            std::size_t _seen = 0;
+        };
+
+        /// @brief curl write callback feeding the scanner, aborting once it is done.
+        size_t scanPageCallback(char *ptr, size_t size, size_t nmemb, void *userdata)
+        {
+            auto *scanner = static_cast<PageScanner *>(userdata);
+            return scanner->feed(ptr, size * nmemb) ? size * nmemb : 0;
         }
-        else
+
+        enum class Field
         {
-            _logger->error("Error initializing curl");
-            curl_global_cleanup();
-            outputFile.close();
-            return MediaDownloader::ReturnCode::MediaDownloadError;
+            Width,
+            Height,
+            Duration,
+            Bitrate,
+            DownloadAddr,
+            PlayAddr,
+            Cover,
+            MusicUrl,
+            MusicDuration,
+            ImageUrl,
+        };
+
+        /// @brief The members of an item the media record is filled from.
+        constexpr std::pair<std::string_view, Field> FIELDS[] = {
+            {"itemInfo.itemStruct.video.width", Field::Width},
+            {"itemInfo.itemStruct.video.height", Field::Height},
+            {"itemInfo.itemStruct.video.duration", Field::Duration},
+            {"itemInfo.itemStruct.video.bitrate", Field::Bitrate},
+            {"itemInfo.itemStruct.video.downloadAddr", Field::DownloadAddr},
+            {"itemInfo.itemStruct.video.playAddr", Field::PlayAddr},
+            {"itemInfo.itemStruct.video.cover", Field::Cover},
+            {"itemInfo.itemStruct.music.playUrl", Field::MusicUrl},
+            {"itemInfo.itemStruct.music.duration", Field::MusicDuration},
+            {"itemInfo.itemStruct.imagePost.images[*].imageURL.urlList[0]", Field::ImageUrl},
+        };
+
+        /// @brief Copy one field into the media record.
+        /// @param field[in] Which field the value is.
+        /// @param value[in] The value, raw text for numbers.
+        /// @param media[in,out] The record to fill.
+        /// @return none.
+        /// NOTE: TikTok durations are in seconds.
+        void applyField(Field field, const std::string &value, MediaInfo &media)
+        {
+            switch (field)
+            {
+            case Field::Width:
+                media.width = jsonPath::toUnsigned(value);
+                break;
+            case Field::Height:
+                media.height = jsonPath::toUnsigned(value);
+                break;
+            case Field::Duration:
+            case Field::MusicDuration:
+                media.durationMs = jsonPath::toUnsigned(value) * 1000;
+                break;
+            case Field::Bitrate:
+                media.bitrate = jsonPath::toUnsigned(value);
+                break;
+            case Field::DownloadAddr:
+                // Unwatermarked, preferred over the play address
+                media.urls.insert(media.urls.begin(), value);
+                break;
+            case Field::PlayAddr:
+            case Field::MusicUrl:
+            case Field::ImageUrl:
+                media.urls.push_back(value);
+                break;
+            case Field::Cover:
+                media.previewUrl = value;
+                break;
+            }
+        }
+    }
+
+    std::map<std::string, std::string> TikTok::_configMap;
+    std::shared_ptr<spdlog::logger> TikTok::_logger = spdlog::stdout_color_mt("TikTok");
+
+    MediaDownloader::ReturnCode
+    TikTok::downloadMedia()
+    {
+        // get the media attributes.
+        const MediaInfo media = getMediaAttributes(MEDIA_URL);
+        if (media.empty())
+        {
+            _logger->error("No media address for {}", MEDIA_URL);
+            return MediaDownloader::ReturnCode::ApiRequestError;
         }
+        _logger->debug("Downloading media from TikTok URL: {}", media.urls.front());
 
-        outputFile.close();
-        _logger->debug("Media downloaded successfully.");
-        return MediaDownloader::ReturnCode::Ok;
+        const std::string filePath(getFromConfigMap("tiktokOutputPath", this->_configMap) + media.id + ".mp4");
+
+        // The addresses are ranked, the next one is tried if a download fails
+        for (const auto &address : media.urls)
+        {
+            if (downloadToFile(address, filePath))
+            {
+                _downloadedPath = filePath;
+                _downloadedType = media.type;
+                _logger->debug("Media downloaded successfully.");
+                return MediaDownloader::ReturnCode::Ok;
+            }
+        }
+
+        _logger->error("Failed to download media for {}", MEDIA_URL);
+        return MediaDownloader::ReturnCode::MediaDownloadError;
     }
 
-    void TikTok::getMediaAttributes(const std::string &url)
+    MediaInfo TikTok::getMediaAttributes(const std::string &url)
     {
         _logger->debug("Getting media attibutes for {}", url);
 
-        // Define regular expression for TikTok URL
-        const std::regex tiktokRegex(R"(https?://(?:www\.)?tiktok\.com/@(\w+)/video/(\d{19}))");
+        MediaInfo media;
 
-        std::smatch match;
+        urlRouter::Route route = urlRouter::route(url);
         std::string longFormatedUrl;
-        if (!std::regex_search(url, match, tiktokRegex))
+        if (route.platform != urlRouter::Platform::TikTok || route.kind != urlRouter::LinkKind::Media)
         {
-            longFormatedUrl = TikTok::performHttpGetRequest(url);
+            // Short link, only its redirect is needed
+            longFormatedUrl = network().resolver().resolve(url);
 
             if (longFormatedUrl.empty())
             {
                 _logger->error("Failed to validate the link.");
-                return;
+                return media;
             }
 
-            longFormatedUrl = extractTiktokUrl(longFormatedUrl);
-            if (!std::regex_search(longFormatedUrl, match, tiktokRegex))
+            route = urlRouter::route(longFormatedUrl);
+            if (route.kind != urlRouter::LinkKind::Media)
             {
                 _logger->error("Invalid TikTok URL: {}", url);
-                return;
+                return media;
             }
         }
 
-        // Extract the username and tweet ID from the matched groups
-        std::string videoId; 
-        std::string username; 
-
-        for (size_t i = 0; i < match.size(); ++i)
-        {
-            _logger->debug("Match {}: {}", i, match[i].str());
-            videoId = match[2].str();
-            username = match[1].str();
-        }
+        // Extract the username and video ID from the link
+        const std::string videoId(route.id);
+        const std::string username(route.username);
+        _logger->debug("TikTok video {} by {}", videoId, username);
 
         // contruct the url for the API request.
         // const std::string response = TikTok::getVideoMetadata(videoId, getFromConfigMap("client_key"));
         const std::string endpoint = getFromConfigMap("metaEndpoint", this->_configMap) + videoId;
 
-        const std::string response = TikTok::performHttpGetRequest(endpoint,
-                                                                   getFromConfigMap("client_key", this->_configMap));
-
-        if (response.empty())
+        // Only the media members are kept, the rest of the item is skipped unparsed
+        jsonPath::Extractor extractor;
+        const std::size_t errors = extractor.add("errors[*].message", false);
+        for (const auto &field : FIELDS)
         {
-            _logger->error("Failed to get media attributes from TikTok API");
-            return;
+            extractor.add(field.first);
         }
 
-        // Parse the JSON response from the TikTok API
-        Json::Value root;
-        Json::Reader reader;
-        if (!reader.parse(response, root))
+        media.id = videoId;
+        media.author = username;
+
+        if (!performJsonRequest(endpoint, urlRouter::Platform::TikTok, extractor))
         {
-            _logger->error("Failed to parse media attributes JSON data");
-            return;
+            // No API answer, read the addresses from the video page instead
+            if (!downloadHttpsPage(longFormatedUrl.empty() ? url : longFormatedUrl, media))
+            {
+                _logger->error("Failed to get media attributes from TikTok API");
+            }
+            return media;
         }
 
         // check for errors in the JSON response.
-        if (root.isMember("errors"))
+        bool failed = false;
+        for (const auto &match : extractor.matches())
         {
-            const Json::Value &error = root["errors"];
-            if (error.isArray())
+            if (match.path == errors)
             {
-                for (const Json::Value &value : error)
-                {
-                    if (value.isMember("message"))
-                    {
-                        _logger->error("TikTok API error: {}", value["message"].asString());
-                    }
-                }
+                _logger->error("TikTok API error: {}", match.value);
+                failed = true;
             }
-            return;
         }
-
-        if (root.isMember("itemInfo") && root["itemInfo"].isMember("itemStruct"))
+        if (failed)
         {
-            const Json::Value &itemStruct = root["itemInfo"]["itemStruct"];
-            std::map<std::string, const Json::Value *> mediaTypes = {{"video", nullptr}, {"image", nullptr}, {"music", nullptr}};
+            return media;
+        }
 
-            /// find the media by type: TODO: needs improvement.
-            for (auto const &mediaType : mediaTypes)
+        // An item with a video also carries its soundtrack, the video wins
+        bool hasVideo = false;
+        bool hasImages = false;
+        for (const auto &match : extractor.matches())
+        {
+            const Field field = FIELDS[match.path - errors - 1].second;
+            if (!match.value.empty())
             {
-                if (itemStruct.isMember(mediaType.first))
-                {
-                    mediaTypes[mediaType.first] = &itemStruct[mediaType.first];
-                    this->mediaType = mediaType.first;
-                    _logger->debug("Media type: {}", this->mediaType);
+                hasVideo |= field == Field::DownloadAddr || field == Field::PlayAddr;
+                hasImages |= field == Field::ImageUrl;
+            }
+        }
+        media.type = hasVideo ? MediaType::Video : hasImages ? MediaType::Image : MediaType::Audio;
 
-                    // retrieve attributes
-                    if (mediaTypes[this->mediaType])
-                    {
-                        const Json::Value &media = *mediaTypes[this->mediaType];
-                        for (const auto &key : media.getMemberNames())
-                        {
-                            if (media[key].isString())
-                            {
-                                _logger->debug("{} key: {}", this->mediaType, key);
-                                _attributes[key] = media[key].asString();
-                            }
-                        }
-                    }
-                    else
-                    {
-                        _logger->error("Failed to get media attributes from TikTok API");
-                        return;
-                    }
-                }
+        for (const auto &match : extractor.matches())
+        {
+            const Field field = FIELDS[match.path - errors - 1].second;
+            const bool music = field == Field::MusicUrl || field == Field::MusicDuration;
+            if (music == (media.type == MediaType::Audio) && !match.value.empty())
+            {
+                applyField(field, match.value, media);
             }
         }
+        if (media.empty())
+        {
+            media.type = MediaType::Unknown;
+        }
+        _logger->debug("Media type: {}, {} address(es)", static_cast<int>(media.type), media.urls.size());
+
         // Log the message that the function finished getting media attributes
         _logger->debug("Finished getting media attributes for TikTok URL: {}", url);
+        return media;
     }
 
+    /// @brief Find the canonical video link in a short link's redirect page.
+    /// @param html[in] The page, e.g. <a href="https://www.tiktok.com/@user/video/...">Moved Permanently</a>.
+    /// @return The first href that is a TikTok video link, empty if none.
     std::string TikTok::extractTiktokUrl(const std::string &html)
     {
-        std::string url;
-
-        // Define regular expression for TikTok URL
-        std::regex tiktokRegex(R"(<a\s+href="https://www.tiktok.com/@\w+/video/\d+)"
-                               R"((?:\?\S+)?"\s*>Moved Permanently</a>)");
+        static constexpr std::string_view href = "href=\"";
 
-        // Search for the TikTok URL in the HTML code
-        std::smatch match;
-        if (std::regex_search(html, match, tiktokRegex))
+        for (std::size_t pos = html.find(href.data(), 0, href.size()); pos != std::string::npos;
+             pos = html.find(href.data(), pos, href.size()))
         {
-            // Extract the URL from the matched group
-            url = match[0];
-            // Remove the <a href=" and ">Moved Permanently</a> parts of the string
-            url = url.substr(9, url.length() - 30);
-        }
+            pos += href.size();
+            const std::size_t end = html.find('"', pos);
+            if (end == std::string::npos)
+            {
+                break;
+            }
 
-        return url;
-    }
+            const std::string_view link(html.data() + pos, end - pos);
+            const urlRouter::Route route = urlRouter::route(link);
+            if (route.platform == urlRouter::Platform::TikTok && route.kind == urlRouter::LinkKind::Media)
+            {
+                return std::string(link);
+            }
+        }
 
-    // Function to download the content of a web page using Boost.Asio and SSL
-    std::string TikTok::downloadHttpsPage(const std::string &url)
-    {
-        return "";
+        return {};
     }
 
-    /**
-     * Performs an HTTP GET request to the specified URL with the specified bearer token.
-     *
-     * @param url The URL to send the request to.
-     * @param bearerToken The bearer token to include in the Authorization header.
-     * @return The response body as a string, or an empty string if an error occurs.
-     */
-    std::string TikTok::performHttpGetRequest(const std::string &url, const std::string &bearerToken)
+    /// @brief Read the media addresses from a video page.
+    /// @param url[in] The canonical video link.
+    /// @param media[out] Gets the download address, then the play address.
+    /// @return false if the page has neither.
+    /// NOTE: the page is scanned as it arrives and the transfer is cut off
+    /// once both addresses are found, instead of buffering the whole page.
+    bool TikTok::downloadHttpsPage(const std::string &url, MediaInfo &media)
     {
-        CURL *curl;
-        CURLcode res;
-        std::string response;
-
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        curl = curl_easy_init();
-
-        if (curl)
+        curlPool::CurlPool &pool = network().pool();
+        auto curl = pool.acquire();
+        if (!curl)
         {
-            struct curl_slist *headers = NULL;
-
-            headers = curl_slist_append(headers, ("Authorization: Bearer " + bearerToken).c_str());
-            headers = curl_slist_append(headers, "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:87.0) Gecko/20100101 Firefox/103.0");
-
-            curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-            curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-            curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, TikTok::writeCallback);
-            curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-            res = curl_easy_perform(curl);
+            _logger->error("Error initializing curl");
+            return false;
+        }
 
-            if (res != CURLE_OK)
-            {
-                std::cerr << "curl_easy_perform() failed: " << curl_easy_strerror(res) << std::endl;
-                curl_easy_cleanup(curl);
-                curl_slist_free_all(headers);
-                curl_global_cleanup();
-                return "";
-            }
+        PageScanner scanner;
+        curl_easy_setopt(curl.get(), CURLOPT_URL, url.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_FOLLOWLOCATION, 1L);
+        curl_easy_setopt(curl.get(), CURLOPT_MAXREDIRS, 5L);
+        curl_easy_setopt(curl.get(), CURLOPT_ACCEPT_ENCODING, "");
+        curl_easy_setopt(curl.get(), CURLOPT_USERAGENT, "Mozilla/5.0 (Windows NT 10.0; Win64; x64; rv:87.0) Gecko/20100101 Firefox/103.0");
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &scanPageCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &scanner);
+
+        const CURLcode res = pool.perform(curl.get());
+        // A write error is the scanner stopping the transfer
+        if (res != CURLE_OK && res != CURLE_WRITE_ERROR)
+        {
+            _logger->error("Failed to fetch {}: {}", url, curl_easy_strerror(res));
+            return false;
+        }
 
-            curl_easy_cleanup(curl);
-            curl_slist_free_all(headers);
+        if (!scanner.downloadAddr.empty())
+        {
+            media.urls.push_back(std::move(scanner.downloadAddr));
         }
-        else
+        if (!scanner.playAddr.empty())
         {
-            std::cerr << "CURL init failed!" << std::endl;
-            curl_global_cleanup();
-            return "";
+            media.urls.push_back(std::move(scanner.playAddr));
         }
-
-        curl_global_cleanup();
-        return response;
-    }
-
-
-    /**
-     * Callback function to receive the response body from a libcurl request.
-     * @param ptr The received data.
-     * @param size The size of each data element.
-     * @param nmemb The number of data elements.
-     * @param userdata A pointer to the string to store the response body in.
-     * @return The number of bytes processed (should be size * nmemb).
-     */
-    size_t TikTok::writeCallback(void *contents, size_t size, size_t nmemb, void *userp)
-    {
-        ((std::string *)userp)->append((char *)contents, size * nmemb);
-        return size * nmemb;
-    }
-
-    size_t TikTok::writeFileCallback(void *contents, size_t size, size_t nmemb, void *userp)
-    {
-        std::ofstream *outputFile = reinterpret_cast<std::ofstream *>(userp);
-        outputFile->write(reinterpret_cast<char *>(contents), size * nmemb);
-        return size * nmemb;
+        if (media.urls.empty())
+        {
+            return false;
+        }
+        media.type = MediaType::Video;
+        return true;
     }
 
     TikTok::~TikTok()
@@ -9,7 +9,7 @@ namespace twitter
     std::shared_ptr<spdlog::logger> Twitter::_logger = spdlog::stdout_color_mt("Twitter");
 
     Twitter::Twitter(const std::string &mediaUrl, Sipeto &sipeto)
-        : MEDIA_URL(mediaUrl), _sipeto(sipeto)
+        : MediaDownloader(sipeto.network()), _sipeto(sipeto), MEDIA_URL(mediaUrl)
     {
         _logger->debug("Twitter constructor");
         API_URL = _sipeto.getFromConfigMap("api_url");
@@ -19,197 +19,129 @@ namespace twitter
     {
         _logger->debug("Downloading media.");
 
-        // Initialize libcurl
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-        CURL *curl = curl_easy_init();
+        curlPool::CurlPool &pool = network().pool();
+        auto curl = pool.acquire();
+        if (!curl)
+        {
+            _logger->error("Failed to initialize curl");
+            return ReturnCode::ApiRequestError;
+        }
 
         // Set up the API request
         std::string apiUrl = API_URL + _mediaId;
-        curl_easy_setopt(curl, CURLOPT_URL, apiUrl.c_str());
-        std::string authHeader = "Authorization: Bearer " + _sipeto.getFromConfigMap("bearer_token");
-        curl_slist *headers = nullptr;
-        headers = curl_slist_append(headers, authHeader.c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
+        std::string response;
+        curl_easy_setopt(curl.get(), CURLOPT_URL, apiUrl.c_str());
+        curl_easy_setopt(curl.get(), CURLOPT_HTTPHEADER, network().headers(urlRouter::Platform::Twitter));
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEFUNCTION, &curlPool::CurlPool::appendCallback);
+        curl_easy_setopt(curl.get(), CURLOPT_WRITEDATA, &response);
 
         // Perform the API request
-        CURLcode res = curl_easy_perform(curl);
+        CURLcode res = pool.perform(curl.get());
         if (res != CURLE_OK)
         {
-            std::cerr << "Error performing API request: " << curl_easy_strerror(res) << std::endl;
+            _logger->error("Error performing API request: {}", curl_easy_strerror(res));
             return ReturnCode::ApiRequestError;
         }
 
         /// TODO: Parse the JSON response
         // ...
 
-        // Download the media file
-        curl_easy_setopt(curl, CURLOPT_URL, MEDIA_URL.c_str());
-        FILE *fp = fopen(_outputFilePath.c_str(), "wb");
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, fp);
-        res = curl_easy_perform(curl);
-        fclose(fp);
-        if (res != CURLE_OK)
+        if (!downloadToFile(MEDIA_URL, _outputFilePath))
         {
-            _logger->error("Error downloading media file: {}", curl_easy_strerror(res));
+            _logger->error("Error downloading media file: {}", MEDIA_URL);
             return ReturnCode::MediaDownloadError;
         }
 
-        // Clean up
-        curl_slist_free_all(headers);
-        curl_easy_cleanup(curl);
-        curl_global_cleanup();
-
+        _downloadedPath = _outputFilePath;
+        _downloadedType = MediaType::Video;
         _logger->debug("Finished downloading media file");
         return ReturnCode::Ok;
     }
 
-    void Twitter::getMediaAttributes(const std::string &url)
+    MediaInfo Twitter::getMediaAttributes(const std::string &url)
     {
-        const std::string lowerUrl = boost::algorithm::to_lower_copy(url);
-        _logger->debug("Getting media attributes for URL: {}", lowerUrl);
-
-        // define regular expression for a twitter link
-        const std::regex twitterRegex(R"(https?://(?:www\.)?twitter\.com/([^/]+)/status/(\d+)(?:\?.*)?)");
+        _logger->debug("Getting media attributes for URL: {}", url);
 
-        // Match the URL against the regular expression
-        std::smatch match;
-        if (!std::regex_match(lowerUrl, match, twitterRegex))
-        {
-            _logger->error("Invalid Twitter link: {}", lowerUrl);
-            return;
-        }
+        MediaInfo media;
 
-        // Extract the username and tweet ID from the matched groups, if available
-        if (!match.size() >= 3)
+        const urlRouter::Route route = urlRouter::route(url);
+        if (route.platform != urlRouter::Platform::Twitter || route.kind != urlRouter::LinkKind::Media)
         {
-            _logger->error("Could not extract username and tweet ID from URL: {}", lowerUrl);
-            return;
+            _logger->error("Invalid Twitter link: {}", url);
+            return media;
         }
 
-        for (size_t i = 0; i < match.size(); ++i)
-        {
-            _logger->debug("Match {}: {}", i, match[i].str());
-        }
-        const std::string username = match[1];
-        const std::string tweetId = match[2];
+        // Extract the username and tweet ID from the link
+        const std::string username(route.username);
+        const std::string tweetId(route.id);
+        _logger->debug("Tweet {} by {}", tweetId, username);
 
         // Construct the URL for the Twitter API endpoint that returns media information
         const std::string &apiUrl(_sipeto.getFromConfigMap("api_url") + tweetId + "&expansions=public_metrics&media.fields=preview_image_url,public_metrics");
 
-        // Make an HTTP request to the Twitter API to get the media information
-        // const std::string responseData = makeHttpRequest(apiUrl, {}, {}, {{"Authorization", "Bearer " + _sipeto.getFromConfigMap("bearer_token")}});
-        const std::string responseData = performHttpGetRequest(apiUrl, _sipeto.getFromConfigMap("bearer_token"));
-
-        if (responseData.empty())
+        // Only the fields below are kept, the rest of the response is skipped unparsed
+        jsonPath::Extractor extractor;
+        const std::size_t errors = extractor.add("errors[*].message", false);
+        const std::size_t error = extractor.add("errors.message", false);
+        const std::size_t type = extractor.add("includes.media[0].type");
+        const std::size_t mediaUrl = extractor.add("includes.media[0].url");
+        const std::size_t duration = extractor.add("includes.media[0].duration_ms");
+        const std::size_t width = extractor.add("includes.media[0].width");
+        const std::size_t height = extractor.add("includes.media[0].height");
+        const std::size_t preview = extractor.add("includes.media[0].preview_image_url");
+        const std::size_t author = extractor.add("data.author_id");
+        const std::size_t id = extractor.add("data.id");
+
+        if (!performJsonRequest(apiUrl, urlRouter::Platform::Twitter, extractor))
         {
             _logger->error("Failed to get media attributes from Twitter API");
-            return;
-        }
-
-        // Parse the JSON response from the Twitter API
-        Json::Value root;
-        Json::Reader reader;
-        if (!reader.parse(responseData, root))
-        {
-            _logger->error("Failed to parse media attributes JSON data");
-            return;
+            return media;
         }
 
         // check for errors in the JSON response.
-        if (root.isMember("errors"))
+        bool failed = false;
+        for (const auto &match : extractor.matches())
         {
-            const Json::Value &error = root["errors"];
-            if (error.isArray())
-            {
-                for (const auto &e : error)
-                {
-                    _logger->error("Error : {}", e["message"].asString());
-                }
-            }
-            else
+            if (match.path == errors || match.path == error)
             {
-                _logger->error("Error : {}", error["message"].asString());
+                _logger->error("Error : {}", match.value);
+                failed = true;
             }
-            return;
         }
-
-        // Extract the media information from the JSON data and store it in the map
-        const Json::Value &media = root["includes"]["media"][0];
-        if (media.empty())
+        if (failed)
         {
-            _logger->error("Failed to get media attributes from Twitter API");
-            return;
+            return media;
         }
 
-        _attributes["type"] = media["type"].asString();
-        _attributes["url"] = media["url"].asString();
-
-        if (media["type"] == "video")
-        {
-            _attributes["duration"] = std::to_string(media["duration_ms"].asInt() / 1000);
-        }
-        else
+        if (!extractor.value(type) && !extractor.value(mediaUrl))
         {
-            _attributes["duration"] = "0";
+            _logger->error("Failed to get media attributes from Twitter API");
+            return media;
         }
 
-        _attributes["width"] = std::to_string(media["width"].asInt());
-        _attributes["height"] = std::to_string(media["height"].asInt());
-        _attributes["preview_url"] = media["preview_image_url"].asString();
-
-        _attributes["username"] = root["data"]["author_id"].asString();
-        _attributes["tweet_id"] = root["data"]["id"].asString();
-
-        _logger->debug("Finished getting media attributes for URL: {}", url);
-    }
-
-    size_t Twitter::writeCallback(char *ptr, size_t size, size_t nmemb, std::string *data)
-    {
-        data->append(ptr, size * nmemb);
-        return size * nmemb;
-    }
-
-    // Define a function to perform an HTTP GET request using libcurl.
-    /// NOTE: it needs to be a member of media downloader class.
-    std::string Twitter::performHttpGetRequest(const std::string &url, const std::string &bearerToken)
-    {
-        // Initialize the libcurl library
-        curl_global_init(CURL_GLOBAL_DEFAULT);
-
-        // Create a new curl session
-        CURL *curl = curl_easy_init();
-        if (!curl)
+        const auto field = [&extractor](std::size_t path)
+        {
+            const std::string *value = extractor.value(path);
+            return value ? std::string_view(*value) : std::string_view();
+        };
+
+        media.type = mediaTypeOf(field(type));
+        media.width = jsonPath::toUnsigned(field(width));
+        media.height = jsonPath::toUnsigned(field(height));
+        if (media.type == MediaType::Video)
         {
-            throw std::runtime_error("Failed to initialize curl");
+            media.durationMs = jsonPath::toUnsigned(field(duration));
         }
-
-        _logger->debug("performing HTTP GET request to URL: {}", url);
-
-        std::string response;
-
-        // Set the curl session options
-        struct curl_slist *headers = NULL;
-        headers = curl_slist_append(headers, ("Authorization: Bearer " + bearerToken).c_str());
-        curl_easy_setopt(curl, CURLOPT_HTTPHEADER, headers);
-        curl_easy_setopt(curl, CURLOPT_URL, url.c_str());
-        curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, writeCallback);
-        curl_easy_setopt(curl, CURLOPT_WRITEDATA, &response);
-
-        // Perform the HTTP GET request
-        CURLcode res = curl_easy_perform(curl);
-        if (res != CURLE_OK)
+        media.id = field(id);
+        media.author = field(author);
+        media.previewUrl = field(preview);
+        if (const std::string *address = extractor.value(mediaUrl))
         {
-            throw std::runtime_error("Failed to perform curl request: " + std::string(curl_easy_strerror(res)));
+            media.urls.push_back(*address);
         }
 
-        // Cleanup and return the HTTP response
-        curl_easy_cleanup(curl);
-        curl_slist_free_all(headers);
-        curl_global_cleanup();
-
-        _logger->debug("Finished performing HTTP GET request to URL: {}", url);
-
-        return response;
+        _logger->debug("Finished getting media attributes for URL: {}", url);
+        return media;
     }
 
     Twitter::~Twitter()
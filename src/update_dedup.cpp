@@ -0,0 +1,80 @@
+#include "include/metrics.h"
+#include "include/update_dedup.h"
+
+namespace updateDedup
+{
+    using metrics::Metrics;
+
+    /// @brief Round the window up to a power of two so slots are a mask away.
+    static std::size_t windowSize(std::size_t size)
+    {
+        std::size_t rounded = 1;
+        while (rounded < size)
+        {
+            rounded <<= 1;
+        }
+        return rounded;
+    }
+
+    /// @brief Create an empty window.
+    /// @param size[in] Number of update ids remembered, rounded up to a power of two.
+    DedupWindow::DedupWindow(std::size_t size)
+        : _mask(windowSize(std::max<std::size_t>(size, 1)) - 1),
+          _slots(new std::atomic<std::int64_t>[_mask + 1]),
+          _checked(Metrics::instance().get("update_dedup_checked_total")),
+          _hits(Metrics::instance().get("update_dedup_hits_total"))
+    {
+        for (std::size_t i = 0; i <= _mask; ++i)
+        {
+            _slots[i].store(0, std::memory_order_relaxed);
+        }
+    }
+
+    std::atomic<std::int64_t> &DedupWindow::slot(std::int64_t updateId)
+    {
+        return _slots[static_cast<std::uint64_t>(updateId) & _mask];
+    }
+
+    /// @brief Record an update id.
+    /// @param updateId[in] The update's id, ignored when not positive.
+    /// @return false if the id was already seen and the update is a redelivery.
+    /// NOTE: an id older than the window is taken as seen, it was processed
+    /// long ago or not at all since the last restart.
+    bool DedupWindow::insert(std::int64_t updateId)
+    {
+        if (updateId <= 0)
+        {
+            return true;
+        }
+        _checked.fetch_add(1, std::memory_order_relaxed);
+
+        auto &entry = slot(updateId);
+        std::int64_t seen = entry.load(std::memory_order_acquire);
+        do
+        {
+            if (seen >= updateId)
+            {
+                _hits.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+        } while (!entry.compare_exchange_weak(seen, updateId, std::memory_order_acq_rel));
+        return true;
+    }
+
+    /// @brief Drop an id again, so a redelivery of an update that was not
+    /// accepted is processed.
+    /// @param updateId[in] The id passed to insert.
+    /// @return none.
+    void DedupWindow::forget(std::int64_t updateId)
+    {
+        if (updateId <= 0)
+        {
+            return;
+        }
+        // Step back one window so older ids in this slot still count as seen
+        std::int64_t expected = updateId;
+        const auto previous = updateId - static_cast<std::int64_t>(_mask + 1);
+        slot(updateId).compare_exchange_strong(expected, previous, std::memory_order_acq_rel);
+    }
+
+} // !namespace updateDedup
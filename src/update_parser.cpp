@@ -0,0 +1,594 @@
+#include "include/string_switch.h"
+#include "include/update_parser.h"
+
+namespace updateParser
+{
+    namespace
+    {
+        /// @brief Recursive-descent scanner over one update body.
+        class Scanner
+        {
+        public:
+            Scanner(std::string_view body, Update &update)
+                : _pos(body.data()), _end(body.data() + body.size()), _body(body), _update(update) {}
+
+            bool parse()
+            {
+                return object([this](std::string_view key)
+                              { return updateField(key); }) &&
+                       (skipSpace(), _pos == _end);
+            }
+
+            /// @brief Split a getUpdates response into its raw updates.
+            bool batch(std::vector<RawUpdate> &updates)
+            {
+                bool ok = false;
+                const bool parsed = object([this, &ok, &updates](std::string_view key)
+                                           {
+                                               if (key == "ok")
+                                               {
+                                                   skipSpace();
+                                                   ok = _end - _pos >= 4 && std::string_view(_pos, 4) == "true";
+                                                   return skipValue();
+                                               }
+                                               if (key == "result")
+                                               {
+                                                   return array(updates);
+                                               }
+                                               return skipValue(); });
+                return parsed && ok;
+            }
+
+        private:
+            /// NOTE: nesting deeper than this is not a Telegram update.
+            static constexpr int MAX_DEPTH = 64;
+
+            void skipSpace()
+            {
+                while (_pos < _end && (*_pos == ' ' || *_pos == '\n' || *_pos == '\r' || *_pos == '\t'))
+                {
+                    ++_pos;
+                }
+            }
+
+            bool consume(char c)
+            {
+                skipSpace();
+                if (_pos < _end && *_pos == c)
+                {
+                    ++_pos;
+                    return true;
+                }
+                return false;
+            }
+
+            /// @brief Walk an object, calling onKey to read or skip each value.
+            template <typename OnKey>
+            bool object(OnKey &&onKey)
+            {
+                if (!consume('{'))
+                {
+                    return false;
+                }
+                if (consume('}'))
+                {
+                    return true;
+                }
+
+                do
+                {
+                    std::string_view key;
+                    skipSpace();
+                    if (!string(key) || !consume(':') || !onKey(key))
+                    {
+                        return false;
+                    }
+                } while (consume(','));
+
+                return consume('}');
+            }
+
+            /// @brief Walk an array, calling onElement to read each element.
+            template <typename OnElement>
+            bool elements(OnElement &&onElement)
+            {
+                if (!consume('['))
+                {
+                    return false;
+                }
+                if (consume(']'))
+                {
+                    return true;
+                }
+
+                do
+                {
+                    skipSpace();
+                    if (!onElement())
+                    {
+                        return false;
+                    }
+                } while (consume(','));
+
+                return consume(']');
+            }
+
+            /// @brief Slice each element of the result array, reading only update_id.
+            bool array(std::vector<RawUpdate> &updates)
+            {
+                return elements([this, &updates]
+                                {
+                                    RawUpdate raw;
+                                    const char *begin = _pos;
+                                    const bool parsed = object([this, &raw](std::string_view key)
+                                                               { return key == "update_id" ? integer(raw.updateId) : skipValue(); });
+                                    if (!parsed)
+                                    {
+                                        return false;
+                                    }
+                                    raw.body = std::string_view(begin, static_cast<std::size_t>(_pos - begin));
+                                    updates.push_back(raw);
+                                    return true; });
+            }
+
+            bool updateField(std::string_view key)
+            {
+                if (key == "update_id")
+                {
+                    return integer(_update.updateId);
+                }
+
+                static constexpr auto types = stringSwitch::makeStringMap<UpdateType>({
+                    {"message", UpdateType::Message},
+                    {"edited_message", UpdateType::EditedMessage},
+                    {"channel_post", UpdateType::ChannelPost},
+                    {"edited_channel_post", UpdateType::EditedChannelPost},
+                    {"callback_query", UpdateType::CallbackQuery},
+                    {"inline_query", UpdateType::InlineQuery},
+                });
+
+                const UpdateType type = types.valueOr(key, UpdateType::Unknown);
+                if (type == UpdateType::Unknown)
+                {
+                    return skipValue();
+                }
+
+                _update.type = type;
+                if (type == UpdateType::CallbackQuery || type == UpdateType::InlineQuery)
+                {
+                    return skipValue();
+                }
+                return object([this](std::string_view field)
+                              { return messageField(field); });
+            }
+
+            bool messageField(std::string_view key)
+            {
+                Message &message = _update.message;
+                if (key == "message_id")
+                {
+                    return integer(message.messageId);
+                }
+                if (key == "date")
+                {
+                    return integer(message.date);
+                }
+                if (key == "text")
+                {
+                    skipSpace();
+                    return string(message.text);
+                }
+                if (key == "from")
+                {
+                    return object([this](std::string_view field)
+                                  { return userField(field); });
+                }
+                if (key == "chat")
+                {
+                    return object([this](std::string_view field)
+                                  { return chatField(field); });
+                }
+                if (key == "entities")
+                {
+                    return elements([this]
+                                    {
+                                        _update.message.entities.emplace_back();
+                                        return object([this](std::string_view field)
+                                                      { return entityField(field); }); });
+                }
+                return skipValue();
+            }
+
+            bool entityField(std::string_view key)
+            {
+                static constexpr auto types = stringSwitch::makeStringMap<EntityType>({
+                    {"url", EntityType::Url},
+                    {"text_link", EntityType::TextLink},
+                    {"bot_command", EntityType::BotCommand},
+                });
+
+                Entity &entity = _update.message.entities.back();
+                if (key == "type")
+                {
+                    std::string_view type;
+                    if (!stringValue(type))
+                    {
+                        return false;
+                    }
+                    entity.type = types.valueOr(type, EntityType::Other);
+                    return true;
+                }
+                if (key == "offset")
+                {
+                    return integer(entity.offset);
+                }
+                if (key == "length")
+                {
+                    return integer(entity.length);
+                }
+                if (key == "url")
+                {
+                    return stringValue(entity.url);
+                }
+                return skipValue();
+            }
+
+            bool userField(std::string_view key)
+            {
+                User &user = _update.message.from;
+                if (key == "id")
+                {
+                    return integer(user.id);
+                }
+                if (key == "first_name")
+                {
+                    return stringValue(user.firstName);
+                }
+                if (key == "last_name")
+                {
+                    return stringValue(user.lastName);
+                }
+                if (key == "username")
+                {
+                    return stringValue(user.userName);
+                }
+                return skipValue();
+            }
+
+            bool chatField(std::string_view key)
+            {
+                Chat &chat = _update.message.chat;
+                if (key == "id")
+                {
+                    return integer(chat.id);
+                }
+                if (key == "type")
+                {
+                    return stringValue(chat.type);
+                }
+                if (key == "title")
+                {
+                    return stringValue(chat.title);
+                }
+                if (key == "username")
+                {
+                    return stringValue(chat.userName);
+                }
+                if (key == "first_name")
+                {
+                    return stringValue(chat.firstName);
+                }
+                if (key == "last_name")
+                {
+                    return stringValue(chat.lastName);
+                }
+                return skipValue();
+            }
+
+            bool stringValue(std::string_view &out)
+            {
+                skipSpace();
+                return string(out);
+            }
+
+            bool integer(std::int64_t &out)
+            {
+                skipSpace();
+                const auto result = std::from_chars(_pos, _end, out);
+                if (result.ec != std::errc())
+                {
+                    return false;
+                }
+                _pos = result.ptr;
+                return true;
+            }
+
+            /// @brief Read a string, as a view into the body when it has no escapes.
+            bool string(std::string_view &out)
+            {
+                if (_pos >= _end || *_pos != '"')
+                {
+                    return false;
+                }
+                const char *begin = ++_pos;
+
+                while (_pos < _end && *_pos != '"' && *_pos != '\\')
+                {
+                    ++_pos;
+                }
+                if (_pos >= _end)
+                {
+                    return false;
+                }
+                if (*_pos == '"')
+                {
+                    out = std::string_view(begin, static_cast<std::size_t>(_pos - begin));
+                    ++_pos;
+                    return true;
+                }
+
+                return decode(begin, out);
+            }
+
+            /// @brief Decode a string with escapes into the scratch buffer.
+            bool decode(const char *begin, std::string_view &out)
+            {
+                std::string &scratch = _update.scratch;
+                if (scratch.empty())
+                {
+                    // Decoded text is never longer than the body
+                    scratch.reserve(_body.size());
+                }
+
+                const std::size_t start = scratch.size();
+                scratch.append(begin, _pos);
+
+                while (_pos < _end && *_pos != '"')
+                {
+                    if (*_pos != '\\')
+                    {
+                        scratch += *_pos++;
+                        continue;
+                    }
+
+                    if (++_pos >= _end)
+                    {
+                        return false;
+                    }
+                    switch (*_pos++)
+                    {
+                    case '"':
+                        scratch += '"';
+                        break;
+                    case '\\':
+                        scratch += '\\';
+                        break;
+                    case '/':
+                        scratch += '/';
+                        break;
+                    case 'b':
+                        scratch += '\b';
+                        break;
+                    case 'f':
+                        scratch += '\f';
+                        break;
+                    case 'n':
+                        scratch += '\n';
+                        break;
+                    case 'r':
+                        scratch += '\r';
+                        break;
+                    case 't':
+                        scratch += '\t';
+                        break;
+                    case 'u':
+                        if (!codePoint(scratch))
+                        {
+                            return false;
+                        }
+                        break;
+                    default:
+                        return false;
+                    }
+                }
+
+                if (_pos >= _end)
+                {
+                    return false;
+                }
+                ++_pos;
+                out = std::string_view(scratch.data() + start, scratch.size() - start);
+                return true;
+            }
+
+            bool hex4(std::uint32_t &value)
+            {
+                if (_end - _pos < 4)
+                {
+                    return false;
+                }
+                const auto result = std::from_chars(_pos, _pos + 4, value, 16);
+                if (result.ptr != _pos + 4)
+                {
+                    return false;
+                }
+                _pos += 4;
+                return true;
+            }
+
+            /// @brief Decode \uXXXX, including surrogate pairs, as UTF-8.
+            bool codePoint(std::string &scratch)
+            {
+                std::uint32_t cp = 0;
+                if (!hex4(cp))
+                {
+                    return false;
+                }
+
+                if (cp >= 0xD800 && cp <= 0xDBFF)
+                {
+                    std::uint32_t low = 0;
+                    if (_end - _pos < 2 || _pos[0] != '\\' || _pos[1] != 'u')
+                    {
+                        return false;
+                    }
+                    _pos += 2;
+                    if (!hex4(low) || low < 0xDC00 || low > 0xDFFF)
+                    {
+                        return false;
+                    }
+                    cp = 0x10000 + ((cp - 0xD800) << 10) + (low - 0xDC00);
+                }
+
+                if (cp < 0x80)
+                {
+                    scratch += static_cast<char>(cp);
+                }
+                else if (cp < 0x800)
+                {
+                    scratch += static_cast<char>(0xC0 | (cp >> 6));
+                    scratch += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                else if (cp < 0x10000)
+                {
+                    scratch += static_cast<char>(0xE0 | (cp >> 12));
+                    scratch += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    scratch += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                else
+                {
+                    scratch += static_cast<char>(0xF0 | (cp >> 18));
+                    scratch += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+                    scratch += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+                    scratch += static_cast<char>(0x80 | (cp & 0x3F));
+                }
+                return true;
+            }
+
+            /// @brief Skip a string without decoding it.
+            bool skipString()
+            {
+                ++_pos;
+                while (_pos < _end)
+                {
+                    const char c = *_pos++;
+                    if (c == '"')
+                    {
+                        return true;
+                    }
+                    if (c == '\\')
+                    {
+                        ++_pos;
+                    }
+                }
+                return false;
+            }
+
+            /// @brief Skip any value, nested objects and arrays included.
+            bool skipValue()
+            {
+                skipSpace();
+                if (_pos >= _end)
+                {
+                    return false;
+                }
+
+                if (*_pos == '"')
+                {
+                    return skipString();
+                }
+
+                if (*_pos != '{' && *_pos != '[')
+                {
+                    // Number, true, false or null
+                    const char *begin = _pos;
+                    while (_pos < _end && *_pos != ',' && *_pos != '}' && *_pos != ']' &&
+                           *_pos != ' ' && *_pos != '\n' && *_pos != '\r' && *_pos != '\t')
+                    {
+                        ++_pos;
+                    }
+                    return _pos != begin;
+                }
+
+                int depth = 0;
+                while (_pos < _end)
+                {
+                    const char c = *_pos;
+                    if (c == '"')
+                    {
+                        if (!skipString())
+                        {
+                            return false;
+                        }
+                        continue;
+                    }
+
+                    ++_pos;
+                    if (c == '{' || c == '[')
+                    {
+                        if (++depth > MAX_DEPTH)
+                        {
+                            return false;
+                        }
+                    }
+                    else if (c == '}' || c == ']')
+                    {
+                        if (--depth == 0)
+                        {
+                            return true;
+                        }
+                    }
+                }
+                return false;
+            }
+
+            const char *_pos;
+            const char *_end;
+            std::string_view _body;
+            Update &_update;
+        };
+    }
+
+    /// @brief Decode a Telegram update.
+    /// @param body[in] The raw update JSON.
+    /// @param update[out] The decoded update, reset first. Keeps the capacity
+    /// of its scratch buffer and entity list.
+    /// @return false if the body is not a well-formed update object.
+    bool parseUpdate(std::string_view body, Update &update)
+    {
+        std::string scratch = std::move(update.scratch);
+        std::vector<Entity> entities = std::move(update.message.entities);
+        scratch.clear();
+        entities.clear();
+        update = Update();
+        update.scratch = std::move(scratch);
+        update.message.entities = std::move(entities);
+
+        return Scanner(body, update).parse();
+    }
+
+    /// @brief Split a getUpdates response into its updates.
+    /// @param body[in] The raw getUpdates response.
+    /// @param updates[out] The updates, appended in order. Views into body.
+    /// @return false if the response is malformed or not "ok".
+    bool parseUpdateBatch(std::string_view body, std::vector<RawUpdate> &updates)
+    {
+        Update unused;
+        return Scanner(body, unused).batch(updates);
+    }
+
+    /// @brief Read the id of an update and the chat it belongs to.
+    /// @param body[in] The raw update JSON.
+    /// @return Both ids, 0 where the update is malformed or has no chat.
+    UpdateKey keyOf(std::string_view body)
+    {
+        // Reused so the scratch buffer is allocated once per thread
+        thread_local Update update;
+        if (!parseUpdate(body, update))
+        {
+            return {};
+        }
+        return {update.updateId, update.message.chat.id};
+    }
+
+} // !namespace updateParser
@@ -0,0 +1,78 @@
+#include "include/string_switch.h"
+#include "include/update_prefilter.h"
+
+namespace updatePrefilter
+{
+    namespace
+    {
+        /// NOTE: second-level labels of the supported hosts, subdomains
+        /// such as vm.tiktok.com or www.instagram.com end in them too.
+        constexpr auto HOSTS = stringSwitch::makeStringMap<bool>({
+            {"tiktok", true},
+            {"twitter", true},
+            {"x", true},
+            {"instagram", true},
+            {"facebook", true},
+        });
+
+        /// NOTE: longest label in HOSTS.
+        constexpr std::size_t MAX_LABEL = 9;
+
+        bool isLabelChar(unsigned char c)
+        {
+            return std::isalnum(c) || c == '-';
+        }
+
+        /// @brief Whether the ".com" at dot ends a supported host.
+        bool isSupportedHost(const char *begin, const char *dot, const char *end)
+        {
+            if (end - dot < 4 || std::tolower(static_cast<unsigned char>(dot[1])) != 'c' ||
+                std::tolower(static_cast<unsigned char>(dot[2])) != 'o' ||
+                std::tolower(static_cast<unsigned char>(dot[3])) != 'm' ||
+                (end - dot > 4 && isLabelChar(static_cast<unsigned char>(dot[4]))))
+            {
+                return false;
+            }
+
+            // Lowercase the label in front of the dot, Telegram keeps the case users typed
+            char label[MAX_LABEL];
+            std::size_t length = 0;
+            for (const char *c = dot; c > begin && isLabelChar(static_cast<unsigned char>(c[-1])); --c)
+            {
+                if (++length > MAX_LABEL)
+                {
+                    return false;
+                }
+                label[MAX_LABEL - length] = static_cast<char>(std::tolower(static_cast<unsigned char>(c[-1])));
+            }
+            return HOSTS.contains(std::string_view(label + MAX_LABEL - length, length));
+        }
+    }
+
+    /// @brief Test a raw update for a supported link or a bot command.
+    /// @param body[in] The raw update JSON.
+    /// @return false if the update can be acknowledged without decoding it.
+    bool mayBeRelevant(std::string_view body)
+    {
+        static constexpr std::string_view command = "\"bot_command\"";
+        if (memmem(body.data(), body.size(), command.data(), command.size()) != nullptr)
+        {
+            return true;
+        }
+
+        // Dots are rare in JSON, so jump between them and check the host around each
+        const char *begin = body.data();
+        const char *end = begin + body.size();
+        for (const char *dot = begin;
+             (dot = static_cast<const char *>(std::memchr(dot, '.', static_cast<std::size_t>(end - dot)))) != nullptr;
+             ++dot)
+        {
+            if (isSupportedHost(begin, dot, end))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+} // !namespace updatePrefilter
@@ -0,0 +1,210 @@
+#include "include/metrics.h"
+#include "include/update_queue.h"
+
+namespace updateQueue
+{
+    using metrics::Metrics;
+
+    UpdateQueue::UpdateQueue(std::size_t capacity, OverflowPolicy policy)
+        : _capacity(std::max<std::size_t>(capacity, 1)),
+          _policy(policy),
+          _depth(Metrics::instance().get("update_queue_depth")),
+          _maxDepth(Metrics::instance().get("update_queue_depth_max")),
+          _enqueued(Metrics::instance().get("update_queue_enqueued_total")),
+          _dequeued(Metrics::instance().get("update_queue_dequeued_total")),
+          _shed(Metrics::instance().get("update_queue_shed_total")),
+          _rejected(Metrics::instance().get("update_queue_rejected_total")),
+          _held(Metrics::instance().get("update_queue_chat_held_total")),
+          _waitMicros(Metrics::instance().get("update_queue_wait_us_total")),
+          _maxWaitMicros(Metrics::instance().get("update_queue_wait_us_max")) {}
+
+    /// @brief Queue a raw update body.
+    /// @param key[in] Chat id of the update, 0 if it has none.
+    /// @param body[in] The webhook request body.
+    /// @param reply[in] Optional slot for an inline webhook reply.
+    /// @return What happened to the update.
+    PushResult UpdateQueue::push(std::int64_t key, std::string body, std::shared_ptr<WebhookReply> reply)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+
+        if (_size >= _capacity && !_closed)
+        {
+            switch (_policy)
+            {
+            case OverflowPolicy::Shed:
+                _shed.fetch_add(1, std::memory_order_relaxed);
+                return PushResult::Shed;
+            case OverflowPolicy::Reject:
+                _rejected.fetch_add(1, std::memory_order_relaxed);
+                return PushResult::Rejected;
+            case OverflowPolicy::Block:
+                _notFull.wait(lock, [this]
+                              { return _size < _capacity || _closed; });
+                break;
+            }
+        }
+
+        if (_closed)
+        {
+            return PushResult::Closed;
+        }
+
+        UpdateTask task{key, std::move(body), std::move(reply), std::chrono::steady_clock::now()};
+        ++_size;
+
+        bool held = false;
+        if (key != 0)
+        {
+            const auto chat = _chats.try_emplace(key);
+            if (!chat.second)
+            {
+                // An earlier update of this chat is queued or running, wait behind it
+                chat.first->second.push_back(std::move(task));
+                held = true;
+            }
+        }
+        if (!held)
+        {
+            _tasks.push_back(std::move(task));
+        }
+        const auto depth = _size;
+        lock.unlock();
+
+        _depth.store(depth, std::memory_order_relaxed);
+        Metrics::storeMax(_maxDepth, depth);
+        _enqueued.fetch_add(1, std::memory_order_relaxed);
+        if (held)
+        {
+            _held.fetch_add(1, std::memory_order_relaxed);
+        }
+        else
+        {
+            _notEmpty.notify_one();
+        }
+        return PushResult::Queued;
+    }
+
+    /// @brief Wait for the next update.
+    /// @param task[out] The dequeued update.
+    /// @return false once the queue is closed and drained.
+    bool UpdateQueue::pop(UpdateTask &task)
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _notEmpty.wait(lock, [this]
+                       { return !_tasks.empty() || _closed; });
+
+        if (_tasks.empty())
+        {
+            return false;
+        }
+
+        task = std::move(_tasks.front());
+        _tasks.pop_front();
+        const auto depth = --_size;
+        lock.unlock();
+
+        _notFull.notify_one();
+
+        const auto waited = std::chrono::duration_cast<std::chrono::microseconds>(
+                                std::chrono::steady_clock::now() - task.enqueuedAt)
+                                .count();
+        _depth.store(depth, std::memory_order_relaxed);
+        _dequeued.fetch_add(1, std::memory_order_relaxed);
+        _waitMicros.fetch_add(static_cast<std::uint64_t>(waited), std::memory_order_relaxed);
+        Metrics::storeMax(_maxWaitMicros, static_cast<std::uint64_t>(waited));
+        return true;
+    }
+
+    /// @brief Release the next update of a chat once its current one is processed.
+    /// @param key[in] Key of the processed update.
+    /// @return none.
+    /// NOTE: every popped update must be marked done, or its chat stalls.
+    void UpdateQueue::done(std::int64_t key)
+    {
+        if (key == 0)
+        {
+            return;
+        }
+
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            const auto chat = _chats.find(key);
+            if (chat == _chats.end())
+            {
+                return;
+            }
+            if (chat->second.empty())
+            {
+                _chats.erase(chat);
+                return;
+            }
+            _tasks.push_back(std::move(chat->second.front()));
+            chat->second.pop_front();
+        }
+        _notEmpty.notify_one();
+    }
+
+    /// @brief Stop accepting updates and wake every waiting thread.
+    /// @param none.
+    /// @return none.
+    void UpdateQueue::close()
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            _closed = true;
+        }
+        _notEmpty.notify_all();
+        _notFull.notify_all();
+    }
+
+    /// @brief Number of updates waiting for a worker, held ones included.
+    /// @param none.
+    /// @return The queue depth.
+    std::size_t UpdateQueue::depth() const
+    {
+        std::lock_guard<std::mutex> lock(_mutex);
+        return _size;
+    }
+
+    /// @brief Hand a Bot API method call to the waiting session.
+    /// @param method[in] Serialized method, e.g. {"method":"sendMessage",...}.
+    /// @return false if the slot was already used or closed.
+    bool WebhookReply::offer(std::string method)
+    {
+        {
+            std::lock_guard<std::mutex> lock(_mutex);
+            if (_closed)
+            {
+                return false;
+            }
+            _closed = true;
+        }
+        _deliver(std::move(method));
+        return true;
+    }
+
+    /// @brief Release the session with an empty 200 if nothing was offered.
+    /// @param none.
+    /// @return none.
+    void WebhookReply::close()
+    {
+        offer(std::string());
+    }
+
+    /// @brief Map the "queuePolicy" config value to a policy.
+    /// @param policy[in] "block", "shed" or "reject".
+    /// @return The matching policy, Reject when unknown.
+    OverflowPolicy UpdateQueue::parsePolicy(const std::string &policy)
+    {
+        if (policy == "block")
+        {
+            return OverflowPolicy::Block;
+        }
+        if (policy == "shed")
+        {
+            return OverflowPolicy::Shed;
+        }
+        return OverflowPolicy::Reject;
+    }
+
+} // !namespace updateQueue
@@ -0,0 +1,258 @@
+#include "include/string_switch.h"
+#include "include/url_router.h"
+
+namespace urlRouter
+{
+    namespace
+    {
+        struct Host
+        {
+            Platform platform = Platform::Unknown;
+            bool shortLink = false;
+        };
+
+        constexpr auto HOSTS = stringSwitch::makeStringMap<Host>({
+            {"tiktok.com", {Platform::TikTok, false}},
+            {"www.tiktok.com", {Platform::TikTok, false}},
+            {"m.tiktok.com", {Platform::TikTok, false}},
+            {"vm.tiktok.com", {Platform::TikTok, true}},
+            {"vt.tiktok.com", {Platform::TikTok, true}},
+            {"twitter.com", {Platform::Twitter, false}},
+            {"www.twitter.com", {Platform::Twitter, false}},
+            {"mobile.twitter.com", {Platform::Twitter, false}},
+            {"x.com", {Platform::Twitter, false}},
+            {"www.x.com", {Platform::Twitter, false}},
+            {"instagram.com", {Platform::Instagram, false}},
+            {"www.instagram.com", {Platform::Instagram, false}},
+            {"facebook.com", {Platform::Facebook, false}},
+            {"www.facebook.com", {Platform::Facebook, false}},
+            {"m.facebook.com", {Platform::Facebook, false}},
+            {"fb.watch", {Platform::Facebook, true}},
+        });
+
+        /// NOTE: longest host in HOSTS.
+        constexpr std::size_t MAX_HOST = 18;
+
+        /// @brief ASCII lowercase, hosts and paths are never localized.
+        inline char lower(char c)
+        {
+            return (c >= 'A' && c <= 'Z') ? static_cast<char>(c + ('a' - 'A')) : c;
+        }
+
+        bool equalsLower(std::string_view text, std::string_view literal)
+        {
+            if (text.size() != literal.size())
+            {
+                return false;
+            }
+            for (std::size_t i = 0; i < text.size(); ++i)
+            {
+                if (lower(text[i]) != literal[i])
+                {
+                    return false;
+                }
+            }
+            return true;
+        }
+
+        /// @brief Cursor over the path of a link.
+        class Path
+        {
+        public:
+            explicit Path(std::string_view path) : _path(path) {}
+
+            /// @brief Consume "/" followed by literal, case-insensitively.
+            bool segment(std::string_view literal)
+            {
+                if (_path.size() < literal.size() + 1 || _path[0] != '/' ||
+                    !equalsLower(_path.substr(1, literal.size()), literal))
+                {
+                    return false;
+                }
+                if (_path.size() > literal.size() + 1 && !isEnd(_path[literal.size() + 1]))
+                {
+                    return false;
+                }
+                _path.remove_prefix(literal.size() + 1);
+                return true;
+            }
+
+            /// @brief Consume "/" followed by a non-empty run of allowed characters.
+            template <typename Allowed>
+            bool capture(std::string_view &out, Allowed &&allowed)
+            {
+                if (_path.empty() || _path[0] != '/')
+                {
+                    return false;
+                }
+                std::size_t end = 1;
+                while (end < _path.size() && allowed(static_cast<unsigned char>(_path[end])))
+                {
+                    ++end;
+                }
+                if (end == 1 || (end < _path.size() && !isEnd(_path[end])))
+                {
+                    return false;
+                }
+                out = _path.substr(1, end - 1);
+                _path.remove_prefix(end);
+                return true;
+            }
+
+        private:
+            static bool isEnd(char c)
+            {
+                return c == '/' || c == '?' || c == '#';
+            }
+
+            std::string_view _path;
+        };
+
+        bool isDigit(unsigned char c)
+        {
+            return c >= '0' && c <= '9';
+        }
+
+        bool isWord(unsigned char c)
+        {
+            return isDigit(c) || (lower(static_cast<char>(c)) >= 'a' && lower(static_cast<char>(c)) <= 'z') || c == '_';
+        }
+
+        /// @brief /@user/video/<19 digit id>
+        bool tiktok(Path path, Route &route)
+        {
+            std::string_view handle;
+            if (!path.capture(handle, [](unsigned char c)
+                              { return isWord(c) || c == '.' || c == '@'; }) ||
+                handle.size() < 2 || handle[0] != '@' ||
+                !path.segment("video") || !path.capture(route.id, isDigit) || route.id.size() != 19)
+            {
+                return false;
+            }
+            route.username = handle.substr(1);
+            return true;
+        }
+
+        /// @brief /<user>/status/<id>
+        bool twitter(Path path, Route &route)
+        {
+            return path.capture(route.username, isWord) && path.segment("status") &&
+                   path.capture(route.id, isDigit);
+        }
+
+        /// @brief /p/<code>, /reel/<code> or /tv/<code>
+        bool instagram(Path path, Route &route)
+        {
+            if (!path.segment("p") && !path.segment("reel") && !path.segment("tv"))
+            {
+                return false;
+            }
+            return path.capture(route.id, [](unsigned char c)
+                                { return isWord(c) || c == '-'; });
+        }
+
+        /// @brief /<code> of a short link
+        bool shortLink(Path path, Route &route)
+        {
+            return path.capture(route.id, [](unsigned char c)
+                                { return isWord(c) || c == '-'; });
+        }
+    }
+
+    /// @brief Classify a link and pull out its media id and username.
+    /// @param url[in] The link, with or without http(s)://.
+    /// @return The route, Platform::Unknown for unsupported hosts and
+    /// LinkKind::Unknown when the path is not a media link.
+    Route route(std::string_view url)
+    {
+        Route route;
+
+        const std::size_t scheme = url.find("://");
+        if (scheme != std::string_view::npos)
+        {
+            const std::string_view name = url.substr(0, scheme);
+            if (!equalsLower(name, "https") && !equalsLower(name, "http"))
+            {
+                return route;
+            }
+            url.remove_prefix(scheme + 3);
+        }
+
+        const std::size_t hostEnd = std::min(url.find_first_of("/?#:"), url.size());
+        if (hostEnd > MAX_HOST)
+        {
+            return route;
+        }
+        char host[MAX_HOST];
+        for (std::size_t i = 0; i < hostEnd; ++i)
+        {
+            host[i] = lower(url[i]);
+        }
+        const Host *match = HOSTS.find(std::string_view(host, hostEnd));
+        if (!match)
+        {
+            return route;
+        }
+        route.platform = match->platform;
+
+        // Skip an explicit port
+        std::string_view path = url.substr(hostEnd);
+        if (!path.empty() && path[0] == ':')
+        {
+            path.remove_prefix(std::min(path.find_first_of("/?#"), path.size()));
+        }
+
+        bool matched = false;
+        if (match->shortLink)
+        {
+            matched = shortLink(Path(path), route);
+            route.kind = matched ? LinkKind::ShortLink : LinkKind::Unknown;
+            return route;
+        }
+
+        switch (match->platform)
+        {
+        case Platform::TikTok:
+            matched = tiktok(Path(path), route);
+            break;
+        case Platform::Twitter:
+            matched = twitter(Path(path), route);
+            break;
+        case Platform::Instagram:
+            matched = instagram(Path(path), route);
+            break;
+        default:
+            break;
+        }
+
+        if (matched)
+        {
+            route.kind = LinkKind::Media;
+        }
+        else
+        {
+            route.id = {};
+            route.username = {};
+        }
+        return route;
+    }
+
+    /// @brief Name of a platform as used for its config section.
+    std::string_view platformName(Platform platform)
+    {
+        switch (platform)
+        {
+        case Platform::TikTok:
+            return "TikTok";
+        case Platform::Twitter:
+            return "Twitter";
+        case Platform::Instagram:
+            return "Instagram";
+        case Platform::Facebook:
+            return "Facebook";
+        default:
+            return "Unknown";
+        }
+    }
+
+} // !namespace urlRouter